@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# === Aggregate read throughput with 1 versus N local replicas ===
+# Usage: ./bench_replicas.sh [replicas] [reads_per_replica]
+REPLICAS=${1:-4}
+READS=${2:-200000}
+FILES=100
+
+# === Compile the project ===
+g++ -std=c++17 -O2 -Wall -pthread main.cpp -o file_system
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# === Primary: build some history and write the mutation log ===
+awk -v files=$FILES 'BEGIN {
+    srand(1);
+    for (f = 0; f < files; f++) print "CREATE file" f;
+    for (i = 0; i < files * 50; i++) {
+        f = int(rand() * files);
+        print "INSERT file" f " line" i;
+        if (i % 3 == 0) print "SNAPSHOT file" f " checkpoint" i;
+    }
+}' > "$WORK/writes.txt"
+./file_system --log "$WORK/primary.log" < "$WORK/writes.txt" > /dev/null
+
+# === Read workload for each replica ===
+awk -v files=$FILES -v reads=$READS 'BEGIN {
+    srand(2);
+    for (i = 0; i < reads; i++) {
+        f = int(rand() * files);
+        if (i % 2 == 0) print "READ file" f; else print "HISTORY file" f;
+    }
+}' > "$WORK/reads.txt"
+
+# Start <n> replicas, let each one SYNC to the end of the log, then time only the reads
+run_replicas() {
+    local n=$1
+    local pids=() fds=() fd
+    for ((r = 0; r < n; r++)); do
+        rm -f "$WORK/in$r" && mkfifo "$WORK/in$r"
+        ./file_system --replica "$WORK/primary.log" < "$WORK/in$r" > "$WORK/out$r" &
+        pids+=($!)
+        exec {fd}> "$WORK/in$r"
+        fds+=($fd)
+        echo "SYNC" >&$fd
+    done
+    # Replay is not part of the measurement: wait until every replica reports it caught up
+    for ((r = 0; r < n; r++)); do
+        until grep -q "Replica caught up." "$WORK/out$r" 2>/dev/null; do sleep 0.05; done
+    done
+
+    local start=$(date +%s.%N)
+    local feeders=()
+    for ((r = 0; r < n; r++)); do
+        cat "$WORK/reads.txt" >&${fds[r]} &
+        feeders+=($!)
+    done
+    wait "${feeders[@]}"
+    for fd in "${fds[@]}"; do exec {fd}>&-; done
+    wait "${pids[@]}"
+    local end=$(date +%s.%N)
+    awk -v n=$n -v reads=$READS -v s=$start -v e=$end \
+        'BEGIN { printf "%2d replica(s): %10.0f reads/s (%.2f s)\n", n, n * reads / (e - s), e - s }'
+}
+
+echo "Log: $(wc -l < "$WORK/primary.log") records, $READS reads per replica, $(nproc) cores"
+run_replicas 1
+run_replicas "$REPLICAS"
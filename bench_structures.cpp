@@ -0,0 +1,138 @@
+#include "file_system.hpp"
+#include <unordered_map>
+#include <queue>
+
+// Microbenchmarks for HashMap, Heap, File and FileSystemManager, with the STL container
+// doing the same job next to the custom ones.
+// Usage: bench_structures [n]   (n = elements/operations per benchmark, default 50000)
+
+static volatile long long sink;          // results go here so the optimizer keeps the work
+
+// Runs f once and prints the time per operation
+template <typename Func>
+void measure(const string& name, long long operations, Func f){
+    auto start = chrono::steady_clock::now();
+    f();
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    cout << left << setw(52) << name << right << setw(12) << fixed << setprecision(1) << ns / operations << " ns/op" << endl;
+}
+
+static void benchHashMap(int n){
+    vector<string> keys;
+    for (int i = 0; i < n; i++) keys.push_back("file" + to_string(i));
+    cout << "== HashMap (" << n << " keys) ==" << endl;
+    {
+        HashMap<string, int> hash_map;
+        measure("HashMap<string,int>::insert", n, [&]{ for (int i = 0; i < n; i++) hash_map.insert(keys[i], i); });
+        measure("HashMap<string,int>::find", n, [&]{ for (int i = 0; i < n; i++) sink += *hash_map.find(keys[i]); });
+        measure("HashMap<string,int>::remove", n, [&]{ for (int i = 0; i < n; i++) sink += hash_map.remove(keys[i]); });
+    }
+    {
+        unordered_map<string, int> reference;
+        measure("unordered_map<string,int>::insert", n, [&]{ for (int i = 0; i < n; i++) reference[keys[i]] = i; });
+        measure("unordered_map<string,int>::find", n, [&]{ for (int i = 0; i < n; i++) sink += reference.find(keys[i])->second; });
+        measure("unordered_map<string,int>::erase", n, [&]{ for (int i = 0; i < n; i++) sink += reference.erase(keys[i]); });
+    }
+    {
+        //Version maps are keyed by int
+        HashMap<int, int> hash_map;
+        measure("HashMap<int,int>::insert", n, [&]{ for (int i = 0; i < n; i++) hash_map.insert(i, i); });
+        measure("HashMap<int,int>::find", n, [&]{ for (int i = 0; i < n; i++) sink += *hash_map.find(i); });
+        unordered_map<int, int> reference;
+        measure("unordered_map<int,int>::insert", n, [&]{ for (int i = 0; i < n; i++) reference[i] = i; });
+        measure("unordered_map<int,int>::find", n, [&]{ for (int i = 0; i < n; i++) sink += reference.find(i)->second; });
+    }
+}
+
+static void benchHeap(int n){
+    mt19937 rng(1);
+    vector<pair<int, string>> items;
+    for (int i = 0; i < n; i++) items.push_back({(int)(rng() % 1000), "file" + to_string(i % 1000)});
+    cout << "== Heap (" << n << " entries) ==" << endl;
+    Heap<pair<int, string>> heap(true);
+    measure("Heap::insert", n, [&]{ for (auto& item : items) heap.insert(item); });
+    measure("Heap::extractTop", n, [&]{ while (!heap.isEmpty()) sink += heap.extractTop().first; });
+    priority_queue<pair<int, string>> reference;
+    measure("priority_queue::push", n, [&]{ for (auto& item : items) reference.push(item); });
+    measure("priority_queue::top+pop", n, [&]{ while (!reference.empty()) { sink += reference.top().first; reference.pop(); } });
+    //RECENT_FILES/BIGGEST_TREES copy the whole heap on every call
+    for (auto& item : items) heap.insert(item);
+    measure("Heap copy (as in RECENT_FILES)", 1, [&]{ Heap<pair<int, string>> copy = heap; sink += copy.size(); });
+}
+
+// A file with n versions: a snapshot after every insert, so every insert branches
+static File* buildFile(int n){
+    File* file = new File("bench");
+    file->root = new TreeNode(0);
+    file->root->message = "Initial Snapshot";
+    file->root->snapshot_timestamp = file->root->created_timestamp = time(nullptr);
+    file->active_version = file->root;
+    file->total_versions = 1;
+    file->addVersion(file->root);
+    for (int i = 1; i < n; i++) {
+        file->insert("x");
+        file->snapshot("s");
+    }
+    return file;
+}
+
+static void benchFile(int n){
+    cout << "== File (" << n << " versions) ==" << endl;
+    File* file = nullptr;
+    measure("File::insert+snapshot (new version)", n, [&]{ file = buildFile(n); });
+    measure("File::rollback(id)", n, [&]{ for (int i = 0; i < n; i++) file->rollback((i * 7919) % n); });
+    file->rollback(n - 1);
+    measure("File::rollback() to parent", n - 1, [&]{ for (int i = 1; i < n; i++) file->rollback(); });
+    file->rollback(n / 2);
+    measure("File::insert in place", n, [&]{
+        file->insert("branch");               //branches once, then edits in place
+        for (int i = 1; i < n; i++) file->insert("y");
+    });
+    file->rollback(n - 1);
+    int reads = 1000;
+    measure("File::read (" + to_string(file->contentLength()) + " bytes)", reads, [&]{ for (int i = 0; i < reads; i++) sink += file->read().size(); });
+    int histories = 10;
+    measure("File::getHistory (deep chain)", histories, [&]{ for (int i = 0; i < histories; i++) sink += file->getHistory().size(); });
+    measure("File::isAncestor", n, [&]{ for (int i = 0; i < n; i++) sink += file->isAncestor(i / 2, i); });
+    //Time travel: branch from an old version, then query
+    measure("File::rollback(id)+update+snapshot+isAncestor", n, [&]{
+        for (int i = 0; i < n; i++) {
+            int total = file->total_versions;
+            file->rollback((i * 7919) % total);
+            if (file->active_version->isSnapshot()) file->update("z");
+            else file->snapshot("t");
+            sink += file->isAncestor((i * 31) % total, total - 1);
+        }
+    });
+    delete file;
+}
+
+static void benchManager(int n){
+    int files = min(n, 10000);
+    vector<string> names;
+    for (int i = 0; i < files; i++) names.push_back("file" + to_string(i));
+    cout << "== FileSystemManager (" << files << " files, " << n << " edits) ==" << endl;
+    FileSystemManager manager;
+    measure("createFile", files, [&]{ for (auto& name : names) manager.createFile(name); });
+    measure("insertFile", n, [&]{ for (int i = 0; i < n; i++) manager.insertFile(names[i % files], "x"); });
+    measure("snapshotFile + insertFile (new version)", n, [&]{
+        for (int i = 0; i < n; i++) {
+            manager.snapshotFile(names[i % files], "s");
+            manager.insertFile(names[i % files], "y");
+        }
+    });
+    string content;
+    measure("readFile", n, [&]{ for (int i = 0; i < n; i++) { manager.readFile(names[i % files], content); sink += content.size(); } });
+    int queries = 20;
+    measure("getRecentFiles(10)", queries, [&]{ for (int i = 0; i < queries; i++) sink += manager.getRecentFiles(10).size(); });
+    measure("getBiggestTrees(10)", queries, [&]{ for (int i = 0; i < queries; i++) sink += manager.getBiggestTrees(10).size(); });
+}
+
+int main(int argc, char* argv[]) {
+    int n = (argc > 1) ? stoi(argv[1]) : 50000;
+    benchHashMap(n);
+    benchHeap(n);
+    benchFile(n);
+    benchManager(n);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# === Microbenchmarks: HashMap, Heap, File, FileSystemManager (and STL equivalents) ===
+# Usage: ./bench_structures.sh [n]
+g++ -std=c++17 -O2 -Wall -pthread bench_structures.cpp -o bench_structures
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+./bench_structures "$@"
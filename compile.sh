@@ -1,7 +1,14 @@
 #!/bin/bash
 
+# === Optional: ./compile.sh --sanitize ... builds with AddressSanitizer and UBSan ===
+FLAGS="-O2"
+if [ "$1" == "--sanitize" ]; then
+    FLAGS="-O1 -g -fno-omit-frame-pointer -fsanitize=address,undefined"
+    shift
+fi
+
 # === Compile the project ===
-g++ -std=c++17 -O2 -Wall main.cpp -o file_system
+g++ -std=c++17 $FLAGS -Wall -pthread main.cpp -o file_system
 
 # === Check if compilation failed ===
 if [ $? -ne 0 ]; then
@@ -10,4 +17,4 @@ if [ $? -ne 0 ]; then
 fi
 
 # === Run the program ===
-./file_system
+./file_system "$@"
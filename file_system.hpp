@@ -8,27 +8,106 @@
 #include <numeric>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <shared_mutex>
+#include <chrono>
+#include <climits>
+#include <random>
 using namespace std;
 
 //function to format time_stamp
 string formatTimestamp(time_t timestamp) {
+    static mutex localtime_lock;            // localtime() returns a shared buffer
+    lock_guard<mutex> guard(localtime_lock);
     tm* tm_ptr =  localtime(&timestamp);
     ostringstream oss;
     oss <<  put_time(tm_ptr, "%Y-%m-%d %H:%M:%S");
     return oss.str();
 }
 
+// Length-prefixed string ("<length>:<bytes>") used in checkpoints
+void writeField(ostream& out, const string& field) {
+    out << field.size() << ':' << field;
+}
+string readField(istream& in) {
+    size_t length = 0;
+    char colon = 0;
+    in >> length >> colon;
+    if (!in || colon != ':') {
+        throw runtime_error("Corrupt checkpoint");
+    }
+    string field(length, '\0');
+    in.read(&field[0], length);
+    return field;
+}
+
+// ===== PinnedClock: clock for version timestamps =====
+// A mutation pins the current time for its whole duration, so every timestamp it records
+// is the same one written to the MutationLog. A replica pins the timestamp of the log
+// record it applies and so reproduces the primary's timestamps. Nested pins keep the outer time.
+class PinnedClock {
+private:
+    static inline thread_local time_t pinned = 0;
+    time_t previous;
+
+public:
+    PinnedClock(time_t at = 0){
+        previous = pinned;
+        if (pinned == 0) {
+            pinned = (at != 0) ? at : time(nullptr);
+        }
+    }
+    ~PinnedClock(){
+        pinned = previous;
+    }
+    time_t now() const{
+        return pinned;
+    }
+    static time_t current(){
+        return (pinned != 0) ? pinned : time(nullptr);
+    }
+};
+
+// ===== ContentBlob: content of a version kept in the ChunkStore =====
+// The ids of the chunks holding the content form a persistent trie (see ChunkStore): a copy
+// of a blob shares the whole trie, and an edit copies only the nodes on its path.
+struct ChunkListNode {
+    int refs;                            // blobs and parent nodes pointing here
+    vector<int> chunks;                  // leaf: chunk ids in order
+    vector<ChunkListNode*> children;     // inner node
+
+    ChunkListNode() : refs(1) {}
+};
+
+struct ContentBlob {
+    ChunkListNode* root;         // nullptr while empty
+    int height;                  // levels of inner nodes above the leaves
+    long long chunk_count;
+    long long length;            // total content length in bytes
+
+    ContentBlob() : root(nullptr), height(0), chunk_count(0), length(0) {}
+};
+
 // ===== TreeNode class for version management =====
 class TreeNode {
 public:
     int version_id;
     string content;
+    ContentBlob blob;            // used instead of content when the file is backed by a ChunkStore
     string message;
     time_t created_timestamp;
     time_t snapshot_timestamp;
     TreeNode* parent;
     vector<TreeNode*> children;
     bool is_snapshot;
+    int depth;                   // distance from the root
 
     TreeNode(int id, string content = "", TreeNode* parent = nullptr){
         this->version_id = id;
@@ -36,9 +115,10 @@ public:
         this->parent = parent;
         this->message = "";
         this->snapshot_timestamp = 0;
-        this->created_timestamp = time(nullptr);
+        this->created_timestamp = PinnedClock::current();
         this->children.clear();
         this->is_snapshot = false;
+        this->depth = 0;
     }
     void addChild(TreeNode* child){
         this->children.push_back(child);
@@ -48,7 +128,7 @@ public:
     }
     void makeSnapshot(const string& msg){
         this->message = msg;
-        this->snapshot_timestamp = time(nullptr);
+        this->snapshot_timestamp = PinnedClock::current();
     }
 };
 
@@ -69,7 +149,7 @@ private:
     
     // hash functions
     int hash(int key) {
-        return key % capacity;
+        return ((key % capacity) + capacity) % capacity;     // negative keys must not give a negative index
     }
 
     int hash(const string& key) {
@@ -159,11 +239,341 @@ public:
             prev = current;
             current = current->next;          //move to next node
         }
-        throw out_of_range("key not found");      //key not found,nothing removed
+        return false;                         //key not found,nothing removed
     }
     int getSize() const{
         return size;
     }
+    void clear(){
+        for (size_t i = 0; i < table.size(); i++) {
+            Node* current = table[i];
+            while (current != nullptr) {
+                Node* to_delete = current;
+                current = current->next;
+                delete to_delete;
+            }
+            table[i] = nullptr;
+        }
+        size = 0;
+    }
+};
+
+// ===== ChunkStore: version contents in fixed-size chunks of a local data file =====
+// Chunks are written once and never modified, so a new version can share all full chunks
+// of its parent. A blob lists its chunks in a 32-way trie whose nodes are reference counted
+// and copied on write: copying a blob is O(1), and appending to it copies at most the
+// O(log chunks) nodes on the path to its last chunk. Every chunk is reference counted by
+// the trie leaves that list it; a chunk no leaf references any more goes on a free list
+// and its slot is reused by the next write.
+// Hot chunks are kept in an LRU page cache; everything else stays on disk and is loaded
+// lazily when a version is read.
+class ChunkStore {
+private:
+    struct CacheNode {
+        int chunk_id;
+        string data;
+        CacheNode* prev;
+        CacheNode* next;
+        CacheNode(int id) : chunk_id(id), prev(nullptr), next(nullptr) {}
+    };
+
+    string path;
+    fstream data_file;
+    int chunk_size;
+    int cache_capacity;
+    int next_chunk_id;
+    vector<int> ref_counts;              // chunk_id -> number of trie leaves listing the chunk
+    vector<int> free_chunks;             // slots of unreferenced chunks, reused before growing the file
+    HashMap<int, CacheNode*> cache;      // chunk_id -> cached chunk
+    CacheNode* head;                     // most recently used chunk
+    CacheNode* tail;                     // least recently used chunk
+    mutex lock;                          // guards the data file and the cache
+
+public:
+    ChunkStore(const string& path, int chunk_size = 64 * 1024, int cache_chunks = 256) : cache(cacheBuckets(chunk_size, cache_chunks)){
+        this->path = path;
+        this->chunk_size = chunk_size;
+        this->cache_capacity = cache_chunks;
+        this->next_chunk_id = 0;
+        this->head = nullptr;
+        this->tail = nullptr;
+
+        data_file.open(path, ios::in | ios::out | ios::binary | ios::trunc);
+        if (!data_file) {
+            throw runtime_error("Cannot open data file: " + path);
+        }
+    }
+    ~ChunkStore(){
+        while (head != nullptr) {
+            CacheNode* to_delete = head;
+            head = head->next;
+            delete to_delete;
+        }
+        data_file.close();
+        remove(path.c_str());          // data file only lives as long as the in-memory version trees
+    }
+    ChunkStore(const ChunkStore&) = delete;
+    ChunkStore& operator=(const ChunkStore&) = delete;
+
+private:
+    // Runs before the cache is built, so bad arguments are reported instead of failing inside HashMap
+    static int cacheBuckets(int chunk_size, int cache_chunks){
+        if (chunk_size <= 0 || cache_chunks <= 0) {
+            throw invalid_argument("Chunk size and cache size must be positive");
+        }
+        return (int)min(2LL * cache_chunks, 1LL << 20);
+    }
+
+public:
+
+    // Call after copying a blob: the copy shares the original's chunk list
+    void retain(const ContentBlob& blob){
+        lock_guard<mutex> guard(lock);
+        if (blob.root != nullptr) blob.root->refs++;
+    }
+    // Drop the blob's references and leave it empty
+    void release(ContentBlob& blob){
+        lock_guard<mutex> guard(lock);
+        releaseNode(blob.root);
+        blob = ContentBlob();
+    }
+    // Append len bytes to the blob. A partial last chunk is re-written together with the new bytes
+    void append(ContentBlob& blob, const char* bytes, size_t len){
+        lock_guard<mutex> guard(lock);
+        string pending;
+        int tail_len = blob.length % chunk_size;
+        if (tail_len != 0) {
+            pending.assign(loadChunk(chunkAt(blob, blob.chunk_count - 1)), 0, tail_len);
+            popChunk(blob);
+            blob.length -= tail_len;
+        }
+        size_t pos = 0;
+        while (pos < len) {
+            size_t take = min(len - pos, (size_t)chunk_size - pending.size());
+            pending.append(bytes + pos, take);
+            pos += take;
+            if ((int)pending.size() == chunk_size) {
+                writeChunk(blob, pending);
+                pending.clear();
+            }
+        }
+        if (!pending.empty()) {
+            writeChunk(blob, pending);
+        }
+    }
+    // Append everything readable from the stream (at most limit bytes if limit >= 0), one chunk at a time
+    void appendStream(ContentBlob& blob, istream& in, long long limit = -1){
+        vector<char> buffer(chunk_size);
+        while (in && limit != 0) {
+            // Fill up the partial last chunk first so every following piece is chunk aligned
+            long long want = chunk_size - blob.length % chunk_size;
+            if (limit > 0) want = min(want, limit);
+            in.read(buffer.data(), want);
+            streamsize got = in.gcount();
+            if (got > 0) {
+                append(blob, buffer.data(), got);
+                if (limit > 0) limit -= got;
+            }
+        }
+    }
+    // Write length bytes of the blob starting at offset (everything from offset if length < 0)
+    void writeTo(const ContentBlob& blob, ostream& out, long long offset = 0, long long length = -1){
+        long long end = (length < 0) ? blob.length : min(blob.length, offset + length);
+        for (long long pos = offset; pos < end; ) {
+            int chunk_offset = pos % chunk_size;
+            int len = (int)min(end - pos, (long long)(chunk_size - chunk_offset));
+            lock_guard<mutex> guard(lock);
+            out.write(loadChunk(chunkAt(blob, pos / chunk_size)).data() + chunk_offset, len);
+            pos += len;
+        }
+    }
+    string materialize(const ContentBlob& blob){
+        ostringstream oss;
+        writeTo(blob, oss);
+        return oss.str();
+    }
+
+private:
+    void writeChunk(ContentBlob& blob, const string& bytes){
+        int chunk_id;
+        if (!free_chunks.empty()) {
+            chunk_id = free_chunks.back();
+            free_chunks.pop_back();
+        } else {
+            chunk_id = next_chunk_id++;
+            ref_counts.push_back(0);
+        }
+        CacheNode* node = new CacheNode(chunk_id);
+        node->data = bytes;
+        node->data.resize(chunk_size, '\0');     // pad so every chunk occupies exactly one slot
+
+        data_file.seekp((streamoff)chunk_id * chunk_size);
+        data_file.write(node->data.data(), chunk_size);
+        if (!data_file) {
+            delete node;
+            throw runtime_error("Failed to write chunk to " + path);
+        }
+        cacheInsert(node);            // freshly written chunks are the most likely to be read next
+
+        ref_counts[chunk_id] = 1;
+        pushChunk(blob, chunk_id);
+        blob.length += bytes.size();
+    }
+
+    // ----- Chunk list: a left-packed trie, LIST_WIDTH chunk ids per leaf and children per inner node -----
+    static const int LIST_BITS = 5;
+    static const int LIST_WIDTH = 1 << LIST_BITS;
+
+    static long long listCapacity(int height){
+        return 1LL << (LIST_BITS * (height + 1));
+    }
+    int chunkAt(const ContentBlob& blob, long long index){
+        ChunkListNode* node = blob.root;
+        for (int level = blob.height; level > 0; level--) {
+            node = node->children[(index >> (LIST_BITS * level)) & (LIST_WIDTH - 1)];
+        }
+        return node->chunks[index & (LIST_WIDTH - 1)];
+    }
+    // Copy on write: a node that another blob or node still points to is copied before it changes
+    ChunkListNode* ownNode(ChunkListNode* node){
+        if (node->refs == 1) return node;
+        ChunkListNode* copy = new ChunkListNode();
+        copy->chunks = node->chunks;
+        copy->children = node->children;
+        for (int chunk_id : copy->chunks) ref_counts[chunk_id]++;
+        for (ChunkListNode* child : copy->children) child->refs++;
+        node->refs--;
+        return copy;
+    }
+    void pushChunk(ContentBlob& blob, int chunk_id){
+        if (blob.root == nullptr) {
+            blob.root = new ChunkListNode();
+            blob.height = 0;
+        } else if (blob.chunk_count == listCapacity(blob.height)) {
+            //Full: the old root becomes the first child of a new root (its reference moves there)
+            ChunkListNode* new_root = new ChunkListNode();
+            new_root->children.push_back(blob.root);
+            blob.root = new_root;
+            blob.height++;
+        }
+        long long index = blob.chunk_count;
+        blob.root = ownNode(blob.root);
+        ChunkListNode* node = blob.root;
+        for (int level = blob.height; level > 0; level--) {
+            size_t slot = (index >> (LIST_BITS * level)) & (LIST_WIDTH - 1);
+            if (slot == node->children.size()) {
+                node->children.push_back(new ChunkListNode());
+            } else {
+                node->children[slot] = ownNode(node->children[slot]);
+            }
+            node = node->children[slot];
+        }
+        node->chunks.push_back(chunk_id);
+        blob.chunk_count++;
+    }
+    // Remove the last chunk id from the blob and drop its reference
+    void popChunk(ContentBlob& blob){
+        long long index = blob.chunk_count - 1;
+        blob.root = ownNode(blob.root);
+        vector<ChunkListNode*> path(1, blob.root);
+        for (int level = blob.height; level > 0; level--) {
+            ChunkListNode* node = path.back();
+            size_t slot = (index >> (LIST_BITS * level)) & (LIST_WIDTH - 1);
+            node->children[slot] = ownNode(node->children[slot]);
+            path.push_back(node->children[slot]);
+        }
+        releaseChunk(path.back()->chunks.back());
+        path.back()->chunks.pop_back();
+        blob.chunk_count--;
+        //Drop nodes left empty (all on the path, so owned by this blob), then unneeded levels
+        while (path.size() > 1 && path.back()->chunks.empty() && path.back()->children.empty()) {
+            delete path.back();
+            path.pop_back();
+            path.back()->children.pop_back();
+        }
+        if (blob.chunk_count == 0) {
+            delete blob.root;
+            blob.root = nullptr;
+            blob.height = 0;
+            return;
+        }
+        while (blob.height > 0 && blob.root->children.size() == 1) {
+            ChunkListNode* child = blob.root->children[0];
+            delete blob.root;
+            blob.root = child;
+            blob.height--;
+        }
+    }
+    void releaseNode(ChunkListNode* node){
+        vector<ChunkListNode*> pending;
+        if (node != nullptr) pending.push_back(node);
+        while (!pending.empty()) {
+            ChunkListNode* current = pending.back();
+            pending.pop_back();
+            if (--current->refs > 0) continue;
+            for (int chunk_id : current->chunks) releaseChunk(chunk_id);
+            for (ChunkListNode* child : current->children) pending.push_back(child);
+            delete current;
+        }
+    }
+    void releaseChunk(int chunk_id){
+        if (--ref_counts[chunk_id] > 0) return;
+        // Unreferenced: drop it from the cache so the slot can be rewritten
+        CacheNode** cached = cache.find(chunk_id);
+        if (cached != nullptr) {
+            CacheNode* node = *cached;
+            unlink(node);
+            cache.remove(chunk_id);
+            delete node;
+        }
+        free_chunks.push_back(chunk_id);
+    }
+    const string& loadChunk(int chunk_id){
+        CacheNode** cached = cache.find(chunk_id);
+        if (cached != nullptr) {
+            // Cache hit: move chunk to the front of the LRU list
+            unlink(*cached);
+            pushFront(*cached);
+            return (*cached)->data;
+        }
+        // Cache miss: read the chunk from the data file
+        CacheNode* node = new CacheNode(chunk_id);
+        node->data.resize(chunk_size);
+        data_file.seekg((streamoff)chunk_id * chunk_size);
+        data_file.read(&node->data[0], chunk_size);
+        if (!data_file) {
+            delete node;
+            throw runtime_error("Failed to read chunk from " + path);
+        }
+        cacheInsert(node);
+        return node->data;
+    }
+    void cacheInsert(CacheNode* node){
+        pushFront(node);
+        cache.insert(node->chunk_id, node);
+        if (cache.getSize() > cache_capacity) {
+            // Evict the least recently used chunk
+            CacheNode* victim = tail;
+            unlink(victim);
+            cache.remove(victim->chunk_id);
+            delete victim;
+        }
+    }
+    void pushFront(CacheNode* node){
+        node->prev = nullptr;
+        node->next = head;
+        if (head != nullptr) head->prev = node;
+        head = node;
+        if (tail == nullptr) tail = node;
+    }
+    void unlink(CacheNode* node){
+        if (node->prev != nullptr) node->prev->next = node->next;
+        else head = node->next;
+        if (node->next != nullptr) node->next->prev = node->prev;
+        else tail = node->prev;
+        node->prev = nullptr;
+        node->next = nullptr;
+    }
 };
 
 // ==== File class =========
@@ -172,82 +582,143 @@ public:
     string filename;
     TreeNode* root;
     TreeNode* active_version;
-    HashMap<int, TreeNode*> version_map;
+    vector<TreeNode*> versions;  // version_id -> version; IDs are dense (0..total_versions-1)
     int total_versions;
     time_t last_modified;
+    ChunkStore* store;           // nullptr keeps contents in memory
 
-    File(const string& name){
+    File(const string& name, ChunkStore* store = nullptr){
         this->filename = name;
+        this->root = nullptr;
+        this->active_version = nullptr;
+        this->total_versions = 0;
+        this->last_modified = 0;
+        this->store = store;
     }
     ~File(){
         deleteSubtree(root);
     }
+    // Checkpoint format: "<total_versions> <active_id> <last_modified>", then one line per
+    // version in version_id order: "<id> <parent_id> <created> <snapshot> <is_snapshot> <message> <content>"
+    void save(ostream& out){
+        out << total_versions << ' ' << active_version->version_id << ' ' << last_modified << '\n';
+        for(int id = 0; id < total_versions; id++){
+            TreeNode* node = versions[id];
+            int parent_id = (node->parent != nullptr) ? node->parent->version_id : -1;
+            out << id << ' ' << parent_id << ' ' << node->created_timestamp << ' ' << node->snapshot_timestamp << ' ' << node->is_snapshot << ' ';
+            writeField(out, node->message);
+            out << ' ';
+            if(store != nullptr){
+                out << node->blob.length << ':';
+                store->writeTo(node->blob, out);
+            }else{
+                writeField(out, node->content);
+            }
+            out << '\n';
+        }
+    }
+    static File* load(istream& in, const string& name, ChunkStore* store){
+        File* file = new File(name, store);
+        try {
+            int total = 0, active_id = 0;
+            in >> total >> active_id >> file->last_modified;
+            for(int id = 0; id < total && in; id++){
+                int node_id = 0, parent_id = -1;
+                TreeNode* node = new TreeNode(id);
+                in >> node_id >> parent_id >> node->created_timestamp >> node->snapshot_timestamp >> node->is_snapshot;
+                //Versions are saved in id order, so the parent is already loaded; only version 0 is a root
+                if(node_id != id || (id == 0) != (parent_id == -1) || parent_id >= id){
+                    delete node;
+                    throw runtime_error("Corrupt checkpoint");
+                }
+                if(parent_id == -1){
+                    file->root = node;
+                }else{
+                    node->parent = file->versions[parent_id];
+                    node->parent->children.push_back(node);
+                }
+                file->addVersion(node);
+                file->total_versions = id + 1;
+                node->message = readField(in);
+                if(store != nullptr){
+                    long long length = 0;
+                    char colon = 0;
+                    in >> length >> colon;
+                    if(colon != ':') throw runtime_error("Corrupt checkpoint");
+                    store->appendStream(node->blob, in, length);
+                }else{
+                    node->content = readField(in);
+                }
+            }
+            if(!in || file->root == nullptr || file->total_versions != total || active_id < 0 || active_id >= total){
+                throw runtime_error("Corrupt checkpoint");
+            }
+            file->active_version = file->versions[active_id];
+        } catch (...) {
+            delete file;
+            throw;
+        }
+        return file;
+    }
     void deleteSubtree(TreeNode* node) {
-        if (node == nullptr) return;
-
-        for (auto child : node->children) {
-            deleteSubtree(child);
+        //Explicit stack: version trees can be far deeper than the call stack
+        vector<TreeNode*> pending;
+        if (node != nullptr) pending.push_back(node);
+        while (!pending.empty()) {
+            TreeNode* current = pending.back();
+            pending.pop_back();
+            for (auto child : current->children) {
+                pending.push_back(child);
+            }
+            if (store != nullptr) store->release(current->blob);
+            delete current;
         }
-        delete node;
     }
     
     void insert(const string& content){
         if(active_version->isSnapshot()){
-            //Create new version
-            string new_content = active_version->content+ " " +content;
-            TreeNode* new_version = createNewVersion(new_content);
-
-            //Parent - child relationship
-            new_version->parent = active_version;
-            active_version->children.push_back(new_version);
-
-            //Set new_version as active version
-            active_version = new_version;
-
-            //Update version map
-            version_map.insert(new_version->version_id,new_version);
-
-            //Update last modified time
-            updateLastModified();
-        }
-        else{
-            //Modify active_version in place
-            active_version->content += " " + content;
-            
-            //Update last modified time
-            updateLastModified();
+            //Create new version holding a copy of the snapshot's content
+            branchFromActive(true);
         }
+        //Append to active_version (in place if it is not a snapshot)
+        appendContent(active_version, " " + content);
+
+        //Update last modified time
+        updateLastModified();
     }
     void update(const string& content){
         if(active_version->isSnapshot()){
-            //Create new version with replaced content
-            TreeNode* new_version = createNewVersion(content);
-
-            //Parent - child relationship
-            new_version->parent = active_version;
-            active_version->children.push_back(new_version);
-
-            //Set new_version as active version
-            active_version = new_version;
-
-            //Update version map
-            version_map.insert(new_version->version_id,new_version);
+            //Create new version with empty content, replaced below
+            branchFromActive(false);
+        }
+        //Replace content of active_version (in place if it is not a snapshot)
+        setContent(active_version, content);
 
-            //Update last modified time
-            updateLastModified();
+        //Update last modified time
+        updateLastModified();
+    }
+    // Streaming variants of insert/update
+    // Content is read from the stream chunk by chunk: all of it, or only limit bytes if limit >= 0
+    void insertFrom(istream& in, long long limit = -1){
+        if(active_version->isSnapshot()){
+            branchFromActive(true);
         }
-        else{
-            //Modify active_version in place
-            active_version->content = content;
-            
-            //Update last modified time
-            updateLastModified();
-        }        
+        appendContent(active_version, " ");
+        appendStream(active_version, in, limit);
+        updateLastModified();
+    }
+    void updateFrom(istream& in, long long limit = -1){
+        if(active_version->isSnapshot()){
+            branchFromActive(false);
+        }
+        setContent(active_version, "");
+        appendStream(active_version, in, limit);
+        updateLastModified();
     }
     void snapshot(const string& message){
         if(!active_version->isSnapshot()){
             active_version->message = message;
-            active_version->snapshot_timestamp = time(nullptr);
+            active_version->snapshot_timestamp = PinnedClock::current();
             active_version->is_snapshot = true;
         }else{
             throw logic_error("This version is already snapshotted");
@@ -264,24 +735,98 @@ public:
                 throw logic_error("Cannot rollback , already at Root");
             }
         }else{
-            // Find the version by ID using the version_map (HashMap)
-            TreeNode** target = version_map.find(version_id);
-
-            if(target != nullptr){
-                active_version = *target;
+            // IDs are dense, so the version is found by indexing
+            if(version_id >= 0 && version_id < total_versions){
+                active_version = versions[version_id];
                 return true;
             }else{
                 return false;      //Version_ID not found
             }
         }
     }
+    // One line per version in the subtree of from_id, in pre-order:
+    // "<version_id> <parent_id> <depth> <flags>", flags: S = snapshot, A = active, - = none.
+    // Versions more than max_depth below from_id are skipped (max_depth < 0: no limit).
+    void exportTree(ostream& out, int from_id = 0, int max_depth = -1){
+        TreeNode* from = getVersion(from_id);
+        for(TreeNode* node : subtree(from, true, max_depth)){
+            string flags;
+            if(node->isSnapshot()) flags += "S";
+            if(node == active_version) flags += "A";
+            if(flags.empty()) flags = "-";
+            out << node->version_id << ' ' << (node->parent ? node->parent->version_id : -1) << ' ' << node->depth << ' ' << flags << '\n';
+        }
+    }
+    // Versions below version_id in pre-order, at most max_depth levels down (max_depth < 0: no limit)
+    vector<int> getDescendants(int version_id, int max_depth = -1){
+        vector<int> descendants;
+        for(TreeNode* node : subtree(getVersion(version_id), false, max_depth)){
+            descendants.push_back(node->version_id);
+        }
+        return descendants;
+    }
+    // Versions from the parent of version_id up to the root
+    vector<int> getAncestors(int version_id){
+        vector<int> ancestors;
+        for(TreeNode* node = getVersion(version_id)->parent; node != nullptr; node = node->parent){
+            ancestors.push_back(node->version_id);
+        }
+        return ancestors;
+    }
+    // O(1): the version's open token lies between the ancestor's open and close tokens
+    bool isAncestor(int ancestor_id, int version_id){
+        TreeNode* ancestor = getVersion(ancestor_id);
+        TreeNode* node = getVersion(version_id);
+        unsigned long long position = order_label[openToken(node)];
+        return order_label[openToken(ancestor)] < position && position < order_label[closeToken(ancestor)];
+    }
+    // Register a new version; its parent must already be registered and IDs come in order
+    void addVersion(TreeNode* node){
+        versions.push_back(node);
+        int open = openToken(node), close = closeToken(node);
+        order_label.resize(close + 1, 0);
+        order_prev.resize(close + 1, -1);
+        order_next.resize(close + 1, -1);
+        if(node->parent == nullptr){
+            node->depth = 0;
+            order_label[open] = 0;
+            order_label[close] = LABEL_SPACE - 1;
+            order_next[open] = close;
+            order_prev[close] = open;
+        }else{
+            node->depth = node->parent->depth + 1;
+            //The newest child comes last in pre-order: right before its parent's close token
+            insertAfter(order_prev[closeToken(node->parent)], open);
+            insertAfter(open, close);
+        }
+    }
     string read() const{
         if(active_version != nullptr){
+            if(store != nullptr){
+                return store->materialize(active_version->blob);    //Load chunks lazily
+            }
             return active_version->content;
         }else{
             throw runtime_error("No active version available");
         }
     }
+    // Write the active content to out without building it as one string
+    // Optionally only length bytes starting at offset (everything from offset if length < 0)
+    void readTo(ostream& out, long long offset = 0, long long length = -1) const{
+        if(active_version == nullptr){
+            throw runtime_error("No active version available");
+        }
+        if(store != nullptr){
+            store->writeTo(active_version->blob, out, offset, length);
+        }else{
+            const string& content = active_version->content;
+            long long end = (length < 0) ? (long long)content.size() : min((long long)content.size(), offset + length);
+            if(offset < end) out.write(content.data() + offset, end - offset);
+        }
+    }
+    long long contentLength() const{
+        return (store != nullptr) ? active_version->blob.length : (long long)active_version->content.size();
+    }
     vector<string> getHistory() const{
         vector<string> history;
         TreeNode* current = active_version;
@@ -307,21 +852,159 @@ public:
     }
     
 private:
-    TreeNode* createNewVersion(const string& content = ""){
+    TreeNode* createNewVersion(TreeNode* parent){
         //Initialisations
         int new_version_id = total_versions;
-        TreeNode* new_version = new TreeNode(new_version_id,content,nullptr);
+        TreeNode* new_version = new TreeNode(new_version_id,"",nullptr);
         new_version->message = "";                      //Not snapshot yet
-        new_version->created_timestamp = time(nullptr);
+        new_version->created_timestamp = PinnedClock::current();
         new_version->snapshot_timestamp = 0;            //0 indicates not snapshot yet
         new_version->children.clear();
 
+        //Parent - child relationship
+        new_version->parent = parent;
+        parent->children.push_back(new_version);
+
+        //Register the version by ID and in the pre-order index
+        addVersion(new_version);
+
         total_versions++;
 
         return new_version;
     }
+    // Create a child of active_version and make it the active version
+    void branchFromActive(bool keep_content){
+        TreeNode* new_version = createNewVersion(active_version);
+        if(keep_content){
+            new_version->content = active_version->content;
+            new_version->blob = active_version->blob;       //Shares the parent's chunks
+            if(store != nullptr) store->retain(new_version->blob);
+        }
+
+        //Set new_version as active version
+        active_version = new_version;
+    }
+    // Pre-order index: every version has an open and a close token in one linked list (an Euler
+    // tour of the tree), so the subtree of a version is everything between its two tokens and
+    // u is an ancestor of v iff v's open token lies between u's tokens. Tokens carry increasing
+    // labels, so that check is two comparisons. A new version goes right before its parent's
+    // close token, wherever the parent is in the tree; when there is no free label there,
+    // the labels of a small aligned range around it are spread out again (list labeling as in
+    // Bender et al., "Two simplified algorithms for maintaining order in a list"), which is
+    // O(log versions) amortized.
+    static const int LABEL_BITS = 62;
+    static const unsigned long long LABEL_SPACE = 1ULL << LABEL_BITS;
+    static constexpr double LABEL_DENSITY = 1.4;     // a range of 2^i labels may hold (2/1.4)^i tokens
+
+    static int openToken(const TreeNode* node){
+        return 2 * node->version_id;
+    }
+    static int closeToken(const TreeNode* node){
+        return 2 * node->version_id + 1;
+    }
+    // Link token after token prev and give it a label between its neighbours
+    void insertAfter(int prev, int token){
+        int next = order_next[prev];
+        order_prev[token] = prev;
+        order_next[token] = next;
+        order_next[prev] = token;
+        if(next != -1) order_prev[next] = token;
+        unsigned long long upper = (next != -1) ? order_label[next] : LABEL_SPACE;
+        order_label[token] = order_label[prev];
+        if(upper - order_label[prev] >= 2){
+            order_label[token] += (upper - order_label[prev]) / 2;
+        }else{
+            relabelAround(token);
+        }
+    }
+    // Find the smallest aligned range of 2^bits labels around token that is sparse enough and
+    // spread the tokens in it evenly over the range
+    void relabelAround(int token){
+        unsigned long long base = order_label[token];
+        int first = token, last = token;
+        long long count = 1;
+        double capacity = 1;
+        for(int bits = 1; bits <= LABEL_BITS; bits++){
+            capacity *= 2 / LABEL_DENSITY;
+            unsigned long long width = 1ULL << bits;
+            unsigned long long low = base & ~(width - 1), high = low + width;
+            //Ranges are nested, so the tokens found so far stay inside
+            while(order_prev[first] != -1 && order_label[order_prev[first]] >= low){
+                first = order_prev[first];
+                count++;
+            }
+            while(order_next[last] != -1 && order_label[order_next[last]] < high){
+                last = order_next[last];
+                count++;
+            }
+            if(count < capacity || bits == LABEL_BITS){
+                unsigned long long step = width / (count + 1);
+                unsigned long long label = low;
+                for(int t = first; ; t = order_next[t]){
+                    label += step;
+                    order_label[t] = label;
+                    if(t == last) break;
+                }
+                return;
+            }
+        }
+    }
+    // Versions in the subtree of from in pre-order, from itself or only below it, at most
+    // max_depth levels down (max_depth < 0: no limit). Deeper subtrees are skipped as a whole
+    vector<TreeNode*> subtree(TreeNode* from, bool include_from, int max_depth){
+        vector<TreeNode*> nodes;
+        int end = closeToken(from);
+        int token = include_from ? openToken(from) : order_next[openToken(from)];
+        while(token != end){
+            if(token % 2 == 1){
+                token = order_next[token];           //close token
+                continue;
+            }
+            TreeNode* node = versions[token / 2];
+            if(max_depth >= 0 && node->depth - from->depth > max_depth){
+                token = order_next[closeToken(node)];
+                continue;
+            }
+            nodes.push_back(node);
+            token = order_next[token];
+        }
+        return nodes;
+    }
+    TreeNode* getVersion(int version_id){
+        if(version_id < 0 || version_id >= total_versions){
+            throw invalid_argument("Version " + to_string(version_id) + " not found");
+        }
+        return versions[version_id];
+    }
+    void appendContent(TreeNode* node, const string& content){
+        if(store != nullptr){
+            store->append(node->blob, content.data(), content.size());
+        }else{
+            node->content += content;
+        }
+    }
+    void setContent(TreeNode* node, const string& content){
+        node->content.clear();
+        if(store != nullptr) store->release(node->blob);
+        appendContent(node, content);
+    }
+    void appendStream(TreeNode* node, istream& in, long long limit = -1){
+        if(store != nullptr){
+            store->appendStream(node->blob, in, limit);
+        }else if(limit < 0){
+            node->content.append(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }else{
+            string buffer(limit, '\0');
+            in.read(&buffer[0], limit);
+            node->content.append(buffer, 0, in.gcount());
+        }
+    }
+    vector<unsigned long long> order_label;  // token -> label, increasing along the list
+    vector<int> order_prev;                  // token -> previous token in pre-order (-1: none)
+    vector<int> order_next;                  // token -> next token in pre-order (-1: none)
+
     void updateLastModified(){
-        last_modified = time(nullptr);          //Set last_modified to current system time 
+        last_modified = PinnedClock::current();          //Set last_modified to current system time 
     }
 };
 
@@ -410,79 +1093,495 @@ public:
     }
 };
 
-// =====  File System Manager  ========
-class FileSystemManager {
+// ===== MutationLog: append-only log of successful mutations =====
+// The first line is "TTFS-LOG <epoch>"; the epoch is new every time a primary (re)creates the
+// log, so replicas and checkpoints can tell one log generation from the next.
+// Then one record per line: "<seq> <timestamp> <command>", where <command> is the command as
+// typed, e.g. "12 1757500000 INSERT notes Hello". INSERT_FILE/UPDATE_FILE are logged as
+// "INSERT_DATA|UPDATE_DATA <filename> <length>" followed by the <length> content bytes and
+// a newline, so replicas never depend on the primary's local files. Replicas tail this file
+// (see LogReplica).
+class MutationLog {
 private:
-    HashMap<string, File*> files;
-    Heap<pair<time_t, string>> recentFilesHeap;  // For RECENT FILES
-    Heap<pair<int, string>> biggestTreesHeap;    // For BIGGEST TREES
+    string path;
+    ofstream log_file;
+    long long next_seq;
+    mutex lock;
+
 public:
-    FileSystemManager(){
-        files = HashMap<string, File*>();
-        
-        // Initialize heaps as max heaps
-        recentFilesHeap = Heap<pair<time_t, string>>(true); 
-        biggestTreesHeap = Heap<pair<int, string>>(true);
+    MutationLog(const string& path){
+        this->path = path;
+        this->next_seq = 1;
+        log_file.open(path, ios::out | ios::binary | ios::trunc);
+        if (!log_file) {
+            throw runtime_error("Cannot open mutation log: " + path);
+        }
+        log_file << "TTFS-LOG " << newEpoch() << '\n';
+        log_file.flush();
     }
-    ~FileSystemManager(){
-        files.forEach([](const string& key,File* fileptr){
-            delete fileptr;             // delete the pointed-to File object to free memory
-        });
+    // write_payload, if given, writes the bytes that follow the record line
+    void append(time_t timestamp, const string& command, function<void(ostream&)> write_payload = nullptr){
+        lock_guard<mutex> guard(lock);
+        log_file << next_seq++ << ' ' << timestamp << ' ' << command << '\n';
+        if (write_payload) {
+            write_payload(log_file);
+            log_file << '\n';
+        }
+        log_file.flush();              // replicas only see what has reached the file
+        if (!log_file) {
+            throw runtime_error("Failed to write mutation log: " + path);
+        }
     }
-    
-    bool createFile(const string& filename){
-        //Chcek if file already exists
-        File* file = getFile(filename);
-        if (file != nullptr) {
-            //File exists,Don't create duplicate
-            return false;
-        }else{
-            //Create new File object dynamically 
-            File* new_file = new File(filename);
 
-             // Initialize the root version in the File object
-            new_file->root = new TreeNode(0);
-            new_file->root->message = "Initial Snapshot";
-            new_file->root->created_timestamp = time(nullptr);
-            new_file->root->snapshot_timestamp = new_file->root->created_timestamp;
-            new_file->root->children.clear();
-            new_file->active_version = new_file->root;
-            new_file->total_versions = 1;
-            new_file->version_map.insert(0, new_file->root);
+private:
+    static string newEpoch(){
+        random_device random;
+        ostringstream oss;
+        oss << hex << chrono::system_clock::now().time_since_epoch().count() << '-' << random();
+        return oss.str();
+    }
+};
 
-            //insert new_file in HashMap files 
-            files.insert(filename, new_file);
+// ===== ChangeFeed: WATCH subscriptions =====
+struct ChangeEvent {
+    const char* kind;            // CREATED, NEW_VERSION, MODIFIED, SNAPSHOT or ROLLBACK
+    string filename;
+    int version_id;              // active version after the change
+    time_t timestamp;
+    int coalesced;               // number of older events of this file merged into this one
 
-            updateMetrics(filename);      // Update heaps after modification
-            return true;              //File created;
+    ChangeEvent() : kind(""), version_id(0), timestamp(0), coalesced(0) {}
+};
+
+// Bounded lock-free ring buffer (Vyukov's MPMC queue): every slot carries a sequence number
+// telling producers and the consumer whose turn it is, so neither side takes a lock.
+class EventRing {
+private:
+    struct Slot {
+        atomic<size_t> sequence;
+        ChangeEvent event;
+    };
+
+    vector<Slot> slots;
+    size_t mask;
+    atomic<size_t> enqueue_pos;
+    atomic<size_t> dequeue_pos;
+
+public:
+    static const size_t MAX_CAPACITY = 1 << 20;
+
+    EventRing(size_t capacity) : slots(roundUpToPowerOfTwo(capacity)){
+        mask = slots.size() - 1;
+        for (size_t i = 0; i < slots.size(); i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
         }
+        enqueue_pos.store(0, memory_order_relaxed);
+        dequeue_pos.store(0, memory_order_relaxed);
     }
-    bool readFile(const string& filename, string& result){
-        File* file = getFile(filename);
-        if (file != nullptr) {
-            result = file->read();
-            return true;
-        }else{
-            //File not found
-            return false;
+    bool tryPush(const ChangeEvent& event){
+        size_t pos = enqueue_pos.load(memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            long long diff = (long long)seq - (long long)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;                    // full
+            } else {
+                pos = enqueue_pos.load(memory_order_relaxed);
+            }
         }
+        slot->event = event;
+        slot->sequence.store(pos + 1, memory_order_seq_cst);     // seq_cst: see Subscription::publish
+        return true;
     }
-    bool insertFile(const string& filename, const string& content){
-        File* file = getFile(filename);
-        if (file != nullptr) {
-            file->insert(content);
-            updateMetrics(filename);   // Update heaps after modification
-            return true;
-        }else{
-            //File not found
-            return false;
+    bool tryPop(ChangeEvent& event){
+        size_t pos = dequeue_pos.load(memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            long long diff = (long long)seq - (long long)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;                    // empty
+            } else {
+                pos = dequeue_pos.load(memory_order_relaxed);
+            }
         }
+        event = move(slot->event);
+        slot->sequence.store(pos + mask + 1, memory_order_release);
+        return true;
     }
-    bool updateFile(const string& filename, const string& content){
-        File* file = getFile(filename);
+    bool isEmpty() const{
+        size_t pos = dequeue_pos.load(memory_order_relaxed);
+        return slots[pos & mask].sequence.load(memory_order_seq_cst) != pos + 1;
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t n){
+        if (n == 0 || n > MAX_CAPACITY) {
+            throw invalid_argument("Event ring capacity must be between 1 and " + to_string(MAX_CAPACITY));
+        }
+        size_t size = 2;
+        while (size < n) size *= 2;
+        return size;
+    }
+};
+
+// One WATCH: events of matching files go into the ring. When the consumer falls behind and
+// the ring is full, further events are coalesced per file (only the newest is kept) and
+// delivered after the ring is drained.
+class Subscription {
+private:
+    int id;
+    string pattern;              // filename, or prefix when it ended with '*'
+    bool is_prefix;
+    EventRing ring;
+
+    mutex overflow_lock;         // slow path only, taken when the ring is full
+    vector<ChangeEvent> overflow;
+    HashMap<string, int> overflow_index;     // filename -> position in overflow
+    atomic<bool> overflowed;
+
+    mutex wait_lock;
+    condition_variable ready;
+    atomic<bool> waiting;        // a consumer is blocked in drain()
+
+public:
+    Subscription(int id, const string& pattern, int capacity) : ring(capacity){
+        this->id = id;
+        this->is_prefix = !pattern.empty() && pattern.back() == '*';
+        this->pattern = is_prefix ? pattern.substr(0, pattern.size() - 1) : pattern;
+        this->overflowed = false;
+        this->waiting = false;
+    }
+    int getId() const{
+        return id;
+    }
+    bool matches(const string& filename) const{
+        if (is_prefix) {
+            return filename.compare(0, pattern.size(), pattern) == 0;
+        }
+        return filename == pattern;
+    }
+    void publish(const ChangeEvent& event){
+        // While older events wait in overflow, newer ones must queue behind them there,
+        // even if the consumer has made room in the ring meanwhile
+        if (overflowed || !ring.tryPush(event)) {
+            lock_guard<mutex> guard(overflow_lock);
+            ChangeEvent merged = event;
+            int* index = overflow_index.find(event.filename);
+            if (index != nullptr) {
+                //The merged event is the newest one, so it moves to the end behind other files' events
+                int position = *index;
+                merged.coalesced = overflow[position].coalesced + 1;
+                overflow.erase(overflow.begin() + position);
+                for (size_t i = position; i < overflow.size(); i++) {
+                    overflow_index.insert(overflow[i].filename, i);
+                }
+            }
+            overflow_index.insert(event.filename, overflow.size());
+            overflow.push_back(merged);
+            overflowed = true;
+        }
+        // The push and the flags are seq_cst, so either a waiting consumer sees the event
+        // in its wait predicate or we see it waiting here and wake it
+        if (waiting) {
+            lock_guard<mutex> guard(wait_lock);
+            ready.notify_one();
+        }
+    }
+    // Take up to max_events pending events; if there are none, wait up to timeout_ms for one
+    vector<ChangeEvent> drain(int max_events, int timeout_ms){
+        vector<ChangeEvent> events;
+        collect(events, max_events);
+        if (events.empty() && timeout_ms > 0) {
+            unique_lock<mutex> guard(wait_lock);
+            waiting = true;
+            ready.wait_for(guard, chrono::milliseconds(timeout_ms), [this]{
+                return !ring.isEmpty() || overflowed;
+            });
+            waiting = false;
+            guard.unlock();
+            collect(events, max_events);
+        }
+        return events;
+    }
+
+private:
+    void collect(vector<ChangeEvent>& events, int max_events){
+        ChangeEvent event;
+        while ((int)events.size() < max_events && ring.tryPop(event)) {
+            events.push_back(event);
+        }
+        if (overflowed && (int)events.size() < max_events) {
+            lock_guard<mutex> guard(overflow_lock);
+            size_t taken = 0;
+            while (taken < overflow.size() && (int)events.size() < max_events) {
+                events.push_back(overflow[taken++]);
+            }
+            overflow.erase(overflow.begin(), overflow.begin() + taken);
+            overflow_index.clear();
+            for (size_t i = 0; i < overflow.size(); i++) {
+                overflow_index.insert(overflow[i].filename, i);
+            }
+            overflowed = !overflow.empty();
+        }
+    }
+};
+
+// All subscriptions of a FileSystemManager. Publishing costs one atomic load when nobody
+// watches; otherwise one ring push per matching subscription.
+class ChangeFeed {
+private:
+    vector<Subscription*> subscribers;
+    shared_mutex lock;                   // shared while publishing, exclusive to (un)subscribe
+    atomic<int> count;
+    int next_id;
+
+public:
+    ChangeFeed(){
+        count = 0;
+        next_id = 1;
+    }
+    ~ChangeFeed(){
+        for (Subscription* subscriber : subscribers) {
+            delete subscriber;
+        }
+    }
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    int subscribe(const string& pattern, int capacity){
+        unique_lock<shared_mutex> guard(lock);
+        Subscription* subscriber = new Subscription(next_id++, pattern, capacity);
+        subscribers.push_back(subscriber);
+        count = subscribers.size();
+        return subscriber->getId();
+    }
+    bool unsubscribe(int id){
+        unique_lock<shared_mutex> guard(lock);
+        for (size_t i = 0; i < subscribers.size(); i++) {
+            if (subscribers[i]->getId() == id) {
+                delete subscribers[i];
+                subscribers.erase(subscribers.begin() + i);
+                count = subscribers.size();
+                return true;
+            }
+        }
+        return false;
+    }
+    void publish(const char* kind, const string& filename, int version_id, time_t timestamp){
+        if (count.load(memory_order_relaxed) == 0) return;
+        ChangeEvent event;
+        event.kind = kind;
+        event.filename = filename;
+        event.version_id = version_id;
+        event.timestamp = timestamp;
+        shared_lock<shared_mutex> guard(lock);
+        for (Subscription* subscriber : subscribers) {
+            if (subscriber->matches(filename)) {
+                subscriber->publish(event);
+            }
+        }
+    }
+    // Returns false if there is no such subscription
+    bool drain(int id, int max_events, int timeout_ms, vector<ChangeEvent>& events){
+        Subscription* subscriber = nullptr;
+        {
+            shared_lock<shared_mutex> guard(lock);
+            for (Subscription* candidate : subscribers) {
+                if (candidate->getId() == id) subscriber = candidate;
+            }
+        }
+        if (subscriber == nullptr) return false;
+        // Only one consumer per subscription; WATCH/UNWATCH/EVENTS run one at a time
+        events = subscriber->drain(max_events, timeout_ms);
+        return true;
+    }
+};
+
+// =====  File System Manager  ========
+class FileSystemManager {
+private:
+    HashMap<string, File*> files;
+    Heap<pair<time_t, string>> recentFilesHeap;  // For RECENT FILES
+    Heap<pair<int, string>> biggestTreesHeap;    // For BIGGEST TREES
+    ChunkStore* store;                           // Optional on-disk storage for version contents
+    MutationLog* mutation_log;                   // Optional log shipped to replicas
+    ChangeFeed changes;                          // WATCH subscriptions
+    mutex registry_lock;                         // Guards files and both heaps; a single File is only
+                                                 // used by one thread at a time (see CommandScheduler)
+public:
+    FileSystemManager(){
+        files = HashMap<string, File*>();
+        store = nullptr;
+        mutation_log = nullptr;
+        
+        // Initialize heaps as max heaps
+        recentFilesHeap = Heap<pair<time_t, string>>(true); 
+        biggestTreesHeap = Heap<pair<int, string>>(true);
+    }
+    ~FileSystemManager(){
+        files.forEach([](const string& key,File* fileptr){
+            delete fileptr;             // delete the pointed-to File object to free memory
+        });
+        delete store;
+        delete mutation_log;
+    }
+
+    // Keep version contents in chunks of a local data file instead of in memory
+    void useChunkStore(const string& path, int chunk_size, int cache_chunks){
+        if (files.getSize() > 0) {
+            throw logic_error("Chunk store must be enabled before any file is created");
+        }
+        ChunkStore* new_store = new ChunkStore(path, chunk_size, cache_chunks);
+        delete store;
+        store = new_store;
+    }
+    // Record every successful mutation in a log that replicas can tail
+    void useMutationLog(const string& path){
+        if (files.getSize() > 0) {
+            throw logic_error("Mutation log must be enabled before any file is created");
+        }
+        MutationLog* new_log = new MutationLog(path);
+        delete mutation_log;
+        mutation_log = new_log;
+    }
+    
+    bool createFile(const string& filename){
+        PinnedClock clock;
+        unique_lock<mutex> guard(registry_lock);
+        //Chcek if file already exists
+        File* file = findFile(filename);
+        if (file != nullptr) {
+            //File exists,Don't create duplicate
+            return false;
+        }else{
+            //Create new File object dynamically 
+            File* new_file = new File(filename, store);
+
+             // Initialize the root version in the File object
+            new_file->root = new TreeNode(0);
+            new_file->root->message = "Initial Snapshot";
+            new_file->root->created_timestamp = PinnedClock::current();
+            new_file->root->snapshot_timestamp = new_file->root->created_timestamp;
+            new_file->root->children.clear();
+            new_file->active_version = new_file->root;
+            new_file->total_versions = 1;
+            new_file->last_modified = new_file->root->created_timestamp;
+            new_file->addVersion(new_file->root);
+
+            //insert new_file in HashMap files 
+            files.insert(filename, new_file);
+            guard.unlock();
+
+            updateMetrics(filename);      // Update heaps after modification
+            logMutation(clock, "CREATE " + filename);
+            changes.publish("CREATED", filename, 0, clock.now());
+            return true;              //File created;
+        }
+    }
+    bool readFile(const string& filename, string& result){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            result = file->read();
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool readFileTo(const string& filename, ostream& out){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            file->readTo(out);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool insertFile(const string& filename, const string& content){
+        PinnedClock clock;
+        File* file = getFile(filename);
         if (file != nullptr) {
+            int versions_before = file->total_versions;
+            file->insert(content);
+            updateMetrics(filename);   // Update heaps after modification
+            logMutation(clock, "INSERT " + filename + " " + content);
+            publishEdit(clock, file, versions_before);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool updateFile(const string& filename, const string& content){
+        PinnedClock clock;
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            int versions_before = file->total_versions;
             file->update(content);
             updateMetrics(filename);             // Update heaps after modification
+            logMutation(clock, "UPDATE " + filename + " " + content);
+            publishEdit(clock, file, versions_before);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    // INSERT/UPDATE with content streamed from a local file
+    bool insertFileFrom(const string& filename, const string& path){
+        if (getFile(filename) == nullptr) {
+            //File not found
+            return false;
+        }
+        ifstream in = openInput(path);
+        return insertFileData(filename, in, -1);
+    }
+    // INSERT with the next length bytes of in (all of it if length < 0); replicas apply INSERT_DATA records with this
+    bool insertFileData(const string& filename, istream& in, long long length){
+        PinnedClock clock;
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            int versions_before = file->total_versions;
+            long long length_before = file->contentLength();
+            file->insertFrom(in, length);
+            updateMetrics(filename);             // Update heaps after modification
+            // Ship the appended bytes (after the separating space), not the path
+            logContent(clock, "INSERT_DATA", file, length_before + 1);
+            publishEdit(clock, file, versions_before);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool updateFileFrom(const string& filename, const string& path){
+        if (getFile(filename) == nullptr) {
+            //File not found
+            return false;
+        }
+        ifstream in = openInput(path);
+        return updateFileData(filename, in, -1);
+    }
+    // UPDATE with the next length bytes of in (all of it if length < 0); replicas apply UPDATE_DATA records with this
+    bool updateFileData(const string& filename, istream& in, long long length){
+        PinnedClock clock;
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            int versions_before = file->total_versions;
+            file->updateFrom(in, length);
+            updateMetrics(filename);             // Update heaps after modification
+            // Ship the new content, not the path
+            logContent(clock, "UPDATE_DATA", file, 0);
+            publishEdit(clock, file, versions_before);
             return true;
         }else{
             //File not found
@@ -490,10 +1589,13 @@ public:
         }
     }
     bool snapshotFile(const string& filename, const string& message){
+        PinnedClock clock;
         File* file = getFile(filename);
         if (file != nullptr) {
             file->snapshot(message);
             updateMetrics(filename);             // Update heaps after modification
+            logMutation(clock, "SNAPSHOT " + filename + " " + message);
+            changes.publish("SNAPSHOT", filename, file->active_version->version_id, clock.now());
             return true;
         }else{
             //File not found
@@ -501,9 +1603,14 @@ public:
         }
     }
     bool rollbackFile(const string& filename, int version_id = -1){
+        PinnedClock clock;
         File* file = getFile(filename);
         if (file != nullptr) {
-            file->rollback(version_id);
+            if (!file->rollback(version_id)) {
+                return false;                     //Version_ID not found
+            }
+            logMutation(clock, "ROLLBACK " + filename + " " + to_string(version_id));
+            changes.publish("ROLLBACK", filename, file->active_version->version_id, clock.now());
             updateMetrics(filename);              // Update heaps after modification
             return true;
         }else{
@@ -520,11 +1627,53 @@ public:
             return false;
         }
     }
+    bool exportTree(const string& filename, ostream& out, int from_id = 0, int max_depth = -1){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            file->exportTree(out, from_id, max_depth);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool getDescendants(const string& filename, int version_id, int max_depth, vector<int>& descendants){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            descendants = file->getDescendants(version_id, max_depth);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool getAncestors(const string& filename, int version_id, vector<int>& ancestors){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            ancestors = file->getAncestors(version_id);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
+    bool isAncestor(const string& filename, int ancestor_id, int version_id, bool& result){
+        File* file = getFile(filename);
+        if (file != nullptr) {
+            result = file->isAncestor(ancestor_id, version_id);
+            return true;
+        }else{
+            //File not found
+            return false;
+        }
+    }
     vector<string> getRecentFiles(int num){
         vector<string> recentFiles;
+        lock_guard<mutex> guard(registry_lock);
         
         // Create a copy of the heap to pop elements without modifying the original
         Heap<pair<time_t, string>> tempHeap = recentFilesHeap;
+        HashMap<string, bool> listed;    // several heap entries of one file can still be valid
 
         int count = 0;
         while(count < num && !tempHeap.isEmpty()){
@@ -532,12 +1681,13 @@ public:
             time_t ts = topEntry.first;
             string fname = topEntry.second;
             //Check if the top entry is still valid (matches the file’s current last_modified)
-            File* file = getFile(fname);
-            if(file && file->last_modified == ts){
+            File* file = findFile(fname);
+            if(file && file->last_modified == ts && listed.find(fname) == nullptr){
                 // Valid Entry
                 // Format output string (e.g., "Filename (Last Modified: YYYY-MM-DD HH:MM:SS)")
                 string formattedEntry = topEntry.second + " (Last Modified: " + formatTimestamp(topEntry.first) + ")";
                 recentFiles.push_back(formattedEntry);
+                listed.insert(fname, true);
                 count++;
             }
             // Otherwise ignore entry
@@ -546,9 +1696,11 @@ public:
     }
     vector<string> getBiggestTrees(int num){
         vector<string> biggestTrees;
+        lock_guard<mutex> guard(registry_lock);
         
         // Create a copy of the heap to pop elements without modifying the original
         Heap<pair<int, string>> tempHeap = biggestTreesHeap;
+        HashMap<string, bool> listed;    // several heap entries of one file can still be valid
     
         int count = 0;
         while(count < num && !tempHeap.isEmpty()) {
@@ -558,32 +1710,107 @@ public:
             string fname = topEntry.second;
             
             //Check if the top entry is still valid (matches the file’s current last_modified)
-            File* file = getFile(fname);
-            if(file && file->total_versions == versions){
+            File* file = findFile(fname);
+            if(file && file->total_versions == versions && listed.find(fname) == nullptr){
                 // Valid Entry
                 // Format output string (e.g., "Filename (Versions: X)"
                 string formattedEntry = topEntry.second + " (Versions: " + to_string(topEntry.first) + ")";
                 biggestTrees.push_back(formattedEntry);
+                listed.insert(fname, true);
                 count++;
             }
             //(file has newer version count), skip and keep popping
         }
         return biggestTrees;
     }
+    // Subscribe to changes of one file, or of every file starting with prefix when pattern is "prefix*"
+    int watch(const string& pattern, int capacity = 1024){
+        return changes.subscribe(pattern, capacity);
+    }
+    bool unwatch(int subscription_id){
+        return changes.unsubscribe(subscription_id);
+    }
+    bool getEvents(int subscription_id, int max_events, int timeout_ms, vector<ChangeEvent>& events){
+        return changes.drain(subscription_id, max_events, timeout_ms, events);
+    }
+    // Write every file with all of its versions to out (see File::save)
+    void saveState(ostream& out){
+        lock_guard<mutex> guard(registry_lock);
+        out << files.getSize() << '\n';
+        files.forEach([&out](const string& filename, File* file){
+            writeField(out, filename);
+            out << '\n';
+            file->save(out);
+        });
+    }
+    // Rebuild the file system from a saveState() dump
+    void loadState(istream& in){
+        if (files.getSize() > 0) {
+            throw logic_error("State can only be loaded into an empty file system");
+        }
+        int count = 0;
+        in >> count;
+        for (int i = 0; i < count && in; i++) {
+            string filename = readField(in);
+            File* file = File::load(in, filename, store);
+            {
+                lock_guard<mutex> guard(registry_lock);
+                files.insert(filename, file);
+            }
+            updateMetrics(filename);
+        }
+        if (!in) {
+            throw runtime_error("Corrupt checkpoint");
+        }
+    }
     
 private:
     // Helper to get a pointer to the File object by filename, returns nullptr if not found
     File* getFile(const string& filename) {
+        lock_guard<mutex> guard(registry_lock);
+        return findFile(filename);
+    }
+    // Same as getFile, for callers already holding registry_lock
+    File* findFile(const string& filename) {
         File** filePtr = files.find(filename);
         if (filePtr != nullptr ) {
             return *filePtr;
         }
         return nullptr;
     }
+
+    // INSERT/UPDATE either created a new version or changed the active one in place
+    void publishEdit(const PinnedClock& clock, File* file, int versions_before){
+        const char* kind = (file->total_versions != versions_before) ? "NEW_VERSION" : "MODIFIED";
+        changes.publish(kind, file->filename, file->active_version->version_id, clock.now());
+    }
+    // Log the active content of file from offset on as the payload of a <kind> record
+    void logContent(const PinnedClock& clock, const string& kind, File* file, long long offset){
+        if (mutation_log != nullptr) {
+            long long length = file->contentLength() - offset;
+            mutation_log->append(clock.now(), kind + " " + file->filename + " " + to_string(length), [&](ostream& out){
+                file->readTo(out, offset, length);
+            });
+        }
+    }
+    void logMutation(const PinnedClock& clock, const string& command){
+        if (mutation_log != nullptr) {
+            mutation_log->append(clock.now(), command);
+        }
+    }
+
+    static ifstream openInput(const string& path){
+        ifstream in(path, ios::binary);
+        if (!in) {
+            throw runtime_error("Cannot open input file: " + path);
+        }
+        return in;
+    }
     
     // Helper to update system-wide analytics metrics related to the file
     void updateMetrics(const string& filename){
-        File* file = getFile(filename);
+        lock_guard<mutex> guard(registry_lock);
+        File* file = findFile(filename);
         if (file != nullptr) {
             // Update recent files heap with last modified time and filename
             recentFilesHeap.insert({file->last_modified, filename});
@@ -594,17 +1821,554 @@ private:
     }
 };
 
+// ===== WorkStealingPool: worker threads with one task deque each =====
+// A worker pops from the back of its own deque and, when that is empty, steals from the
+// front of the other workers' deques. Tasks submitted by a worker go to its own deque.
+class WorkStealingPool {
+private:
+    struct WorkQueue {
+        deque<function<void()>> tasks;
+        mutex lock;
+    };
+
+    vector<WorkQueue*> queues;
+    vector<thread> workers;
+    mutex wake_lock;
+    condition_variable wake;             // signalled when a task is queued or on shutdown
+    condition_variable idle;             // signalled when the last unfinished task is done
+    atomic<int> queued;                  // tasks waiting in some deque
+    atomic<int> unfinished;              // tasks submitted but not finished yet
+    atomic<unsigned> next_queue;         // round robin target for submits from outside the pool
+    bool stopping;                       // guarded by wake_lock
+
+    static inline thread_local WorkStealingPool* current_pool = nullptr;
+    static inline thread_local int current_worker = -1;
+
+public:
+    WorkStealingPool(int num_threads){
+        if (num_threads <= 0) {
+            throw invalid_argument("Thread count must be positive");
+        }
+        queued = 0;
+        unfinished = 0;
+        next_queue = 0;
+        stopping = false;
+        for (int i = 0; i < num_threads; i++) {
+            queues.push_back(new WorkQueue());
+        }
+        for (int i = 0; i < num_threads; i++) {
+            workers.emplace_back([this, i]{ workerLoop(i); });
+        }
+    }
+    ~WorkStealingPool(){
+        {
+            lock_guard<mutex> guard(wake_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (WorkQueue* queue : queues) {
+            delete queue;
+        }
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(function<void()> task){
+        unfinished++;
+        int index = (current_pool == this) ? current_worker : (int)(next_queue++ % queues.size());
+        {
+            lock_guard<mutex> guard(queues[index]->lock);
+            queues[index]->tasks.push_back(move(task));
+        }
+        queued++;
+        {
+            lock_guard<mutex> guard(wake_lock);     // pairs with the predicate check in workerLoop
+        }
+        wake.notify_one();
+    }
+    // Block until every submitted task (including tasks they submitted) has finished
+    void waitIdle(){
+        unique_lock<mutex> guard(wake_lock);
+        idle.wait(guard, [this]{ return unfinished == 0; });
+    }
+
+private:
+    void workerLoop(int index){
+        current_pool = this;
+        current_worker = index;
+        while (true) {
+            function<void()> task;
+            if (takeTask(index, task)) {
+                task();
+                if (--unfinished == 0) {
+                    lock_guard<mutex> guard(wake_lock);
+                    idle.notify_all();
+                }
+                continue;
+            }
+            unique_lock<mutex> guard(wake_lock);
+            wake.wait(guard, [this]{ return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+    bool takeTask(int index, function<void()>& task){
+        // Own deque first (LIFO), then steal from the others (FIFO)
+        for (size_t i = 0; i < queues.size(); i++) {
+            WorkQueue* queue = queues[(index + i) % queues.size()];
+            lock_guard<mutex> guard(queue->lock);
+            if (!queue->tasks.empty()) {
+                if (i == 0) {
+                    task = move(queue->tasks.back());
+                    queue->tasks.pop_back();
+                } else {
+                    task = move(queue->tasks.front());
+                    queue->tasks.pop_front();
+                }
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// ===== CommandScheduler: parallel execution of a command stream =====
+// Commands are keyed by their filename. Commands on the same file run in input order,
+// commands on different files run in parallel on a WorkStealingPool. Each command writes
+// into its own buffer and a reorder buffer prints the buffers in input order.
+// RECENT_FILES and BIGGEST_TREES read every file, so they wait for all earlier commands
+// and run alone; so do WATCH, UNWATCH and EVENTS, which share the subscription list.
+class CommandScheduler {
+public:
+    typedef function<void(const vector<string>&, ostream&)> Executor;
+
+private:
+    struct Job {
+        int seq;
+        vector<string> tokens;
+    };
+    struct FileQueue {
+        deque<Job> jobs;
+        bool scheduled;                  // a drain task for this queue is in the pool
+        FileQueue() : scheduled(false) {}
+    };
+
+    Executor execute;
+    ostream& out;
+    int max_in_flight;                   // commands submitted but not printed yet
+    int next_seq;                        // only used by the submitting thread
+
+    HashMap<string, FileQueue*> file_queues;
+    mutex queue_lock;                    // guards file_queues and their contents
+
+    HashMap<int, string> finished;       // reorder buffer: seq -> output
+    int next_output;                     // seq of the next output to print
+    mutex output_lock;                   // guards finished and next_output
+    condition_variable output_drained;
+
+    WorkStealingPool pool;               // declared last so workers stop before the rest is destroyed
+
+public:
+    CommandScheduler(int num_threads, Executor execute, ostream& out, int max_in_flight = 4096)
+        : execute(execute), out(out), file_queues(1024), finished(1024), pool(num_threads){
+        this->max_in_flight = max_in_flight;
+        this->next_seq = 0;
+        this->next_output = 0;
+    }
+    ~CommandScheduler(){
+        pool.waitIdle();
+        file_queues.forEach([](const string& key, FileQueue* queue){
+            delete queue;
+        });
+    }
+
+    void submit(const vector<string>& tokens){
+        int seq = next_seq++;
+        {
+            // Bound the reorder buffer when one file holds up the output
+            unique_lock<mutex> guard(output_lock);
+            output_drained.wait(guard, [&]{ return seq - next_output < max_in_flight; });
+        }
+
+        if (isBarrier(tokens)) {
+            pool.waitIdle();
+            complete(seq, runJob(tokens));
+            return;
+        }
+
+        string key = tokens.size() >= 2 ? tokens[1] : "";
+        FileQueue* queue;
+        bool start = false;
+        {
+            lock_guard<mutex> guard(queue_lock);
+            FileQueue** found = file_queues.find(key);
+            if (found != nullptr) {
+                queue = *found;
+            } else {
+                queue = new FileQueue();
+                file_queues.insert(key, queue);
+            }
+            queue->jobs.push_back({seq, tokens});
+            if (!queue->scheduled) {
+                queue->scheduled = true;
+                start = true;
+            }
+        }
+        if (start) {
+            pool.submit([this, queue]{ drain(queue); });
+        }
+    }
+    // Wait until every submitted command has run and its output is printed
+    void finish(){
+        pool.waitIdle();
+        out.flush();
+    }
+
+private:
+    static bool isBarrier(const vector<string>& tokens){
+        string cmd = tokens[0];
+        transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+        return cmd == "RECENT_FILES" || cmd == "BIGGEST_TREES" ||
+               cmd == "WATCH" || cmd == "UNWATCH" || cmd == "EVENTS";
+    }
+    // Run the oldest command of a file, then requeue the file if it has more
+    void drain(FileQueue* queue){
+        Job job;
+        {
+            lock_guard<mutex> guard(queue_lock);
+            job = move(queue->jobs.front());
+            queue->jobs.pop_front();
+        }
+        complete(job.seq, runJob(job.tokens));
+        {
+            lock_guard<mutex> guard(queue_lock);
+            if (queue->jobs.empty()) {
+                queue->scheduled = false;
+                return;
+            }
+        }
+        pool.submit([this, queue]{ drain(queue); });
+    }
+    string runJob(const vector<string>& tokens){
+        ostringstream oss;
+        try {
+            execute(tokens, oss);
+        } catch (const exception& e) {
+            oss << "Error: " << e.what() << endl;
+        }
+        return oss.str();
+    }
+    void complete(int seq, const string& output){
+        lock_guard<mutex> guard(output_lock);
+        finished.insert(seq, output);
+        // Print every buffered output that is next in input order
+        string* ready = finished.find(next_output);
+        while (ready != nullptr) {
+            out << *ready;
+            finished.remove(next_output);
+            next_output++;
+            ready = finished.find(next_output);
+        }
+        output_drained.notify_all();
+    }
+};
+
+// ===== LogReplica: read-only copy of a primary, kept up to date from its MutationLog =====
+// A background thread tails the log file and applies each record under the exclusive state
+// lock; readers take the shared lock. Staleness is the time since the tailer last reached
+// the end of the log: everything the primary had written by then has been applied.
+// Replication stops with an error if the log is recreated (new epoch) or shrinks below the
+// replica's position, instead of reporting a stale state as fresh.
+class LogReplica {
+public:
+    // Applies one record; *_DATA records read their payload from the stream
+    typedef function<void(const vector<string>&, istream&)> Applier;
+
+private:
+    string log_path;
+    Applier apply;
+    shared_mutex state_lock;             // exclusive while a record is applied
+
+    mutex status_lock;                   // guards the fields below
+    condition_variable progress;         // signalled whenever the tailer reaches the end of the log
+    long long applied_seq;
+    time_t applied_timestamp;
+    streamoff offset;                    // log position after the last applied record (0: none yet)
+    string epoch;                        // epoch of the log being followed, empty until its header is read
+    chrono::steady_clock::time_point started;
+    chrono::steady_clock::time_point caught_up_at;
+    bool caught_up;                      // tailer has reached the end of the log at least once
+    string error;                        // set when replication stopped
+
+    atomic<bool> stopping;
+    thread tailer;
+
+public:
+    // epoch, applied_seq and offset come from a checkpoint; leave them empty/0 to replay the whole log
+    LogReplica(const string& log_path, Applier apply, const string& epoch = "", long long applied_seq = 0, streamoff offset = 0)
+        : log_path(log_path), apply(apply), epoch(epoch){
+        this->applied_seq = applied_seq;
+        this->applied_timestamp = 0;
+        this->offset = offset;
+        this->started = chrono::steady_clock::now();
+        this->caught_up = false;
+        this->stopping = false;
+        tailer = thread([this]{ tailLoop(); });
+    }
+    ~LogReplica(){
+        stopping = true;
+        tailer.join();
+    }
+    LogReplica(const LogReplica&) = delete;
+    LogReplica& operator=(const LogReplica&) = delete;
+
+    shared_lock<shared_mutex> lockForRead(){
+        return shared_lock<shared_mutex>(state_lock);
+    }
+    // Log position of the state currently visible to readers; call with lockForRead() held
+    void position(string& log_epoch, long long& seq, streamoff& log_offset){
+        lock_guard<mutex> guard(status_lock);
+        log_epoch = epoch;
+        seq = applied_seq;
+        log_offset = offset;
+    }
+    long long stalenessMs(){
+        lock_guard<mutex> guard(status_lock);
+        auto since = caught_up ? caught_up_at : started;
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - since).count();
+    }
+    string status(){
+        long long staleness = stalenessMs();
+        lock_guard<mutex> guard(status_lock);
+        ostringstream oss;
+        oss << "Applied seq: " << applied_seq;
+        if (applied_timestamp != 0) {
+            oss << " (Primary time: " << formatTimestamp(applied_timestamp) << ")";
+        }
+        oss << ", Staleness: " << staleness << " ms";
+        if (!caught_up) {
+            oss << " (catching up)";
+        }
+        if (!error.empty()) {
+            oss << ", Replication stopped: " << error;
+        }
+        return oss.str();
+    }
+    // Wait until every record written to the log before this call is applied
+    bool sync(int timeout_ms){
+        unique_lock<mutex> guard(status_lock);
+        auto requested = chrono::steady_clock::now();
+        return progress.wait_for(guard, chrono::milliseconds(timeout_ms), [&]{
+            return (caught_up && caught_up_at > requested) || !error.empty();
+        }) && error.empty();
+    }
+
+private:
+    void tailLoop(){
+        ifstream in;
+        streamoff position = offset;
+        while (!stopping) {
+            if (!in.is_open()) {
+                in.open(log_path, ios::binary);      // the primary may not have created it yet
+            }
+            if (in.is_open()) {
+                try {
+                    // Taken before looking at the log: if this pass reaches the end, everything the
+                    // primary had written by now is applied
+                    auto pass_started = chrono::steady_clock::now();
+                    in.clear();
+                    if (checkLog(in, position)) {
+                        in.seekg(position);
+                        string line;
+                        bool reached_end = true;
+                        while (!stopping && getline(in, line)) {
+                            // A record without its final '\n', or a *_DATA record without its whole payload,
+                            // is still being written; it is re-read on the next poll
+                            if (in.eof() || !applyRecord(line, in)) {
+                                reached_end = false;
+                                break;
+                            }
+                            position = in.tellg();
+                        }
+                        if (reached_end && !stopping) {
+                            lock_guard<mutex> guard(status_lock);
+                            caught_up = true;
+                            caught_up_at = pass_started;
+                            progress.notify_all();
+                        }
+                    }
+                } catch (const exception& e) {
+                    lock_guard<mutex> guard(status_lock);
+                    error = e.what();
+                    progress.notify_all();
+                    return;
+                }
+            }
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+    }
+    // Make sure the file is still the log generation we follow and has not shrunk.
+    // Returns false while the header has not been written completely.
+    bool checkLog(ifstream& in, streamoff& position){
+        in.seekg(0);
+        string header;
+        if (!getline(in, header) || in.eof()) {
+            return false;
+        }
+        istringstream ss(header);
+        string magic, log_epoch;
+        ss >> magic >> log_epoch;
+        if (magic != "TTFS-LOG" || log_epoch.empty()) {
+            throw runtime_error("not a mutation log: " + log_path);
+        }
+        streamoff header_end = in.tellg();
+        {
+            lock_guard<mutex> guard(status_lock);
+            if (epoch.empty()) {
+                epoch = log_epoch;
+            } else if (epoch != log_epoch) {
+                throw runtime_error("log was recreated by a new primary (epoch " + log_epoch + ", expected " + epoch + ")");
+            }
+        }
+        in.seekg(0, ios::end);
+        streamoff size = in.tellg();
+        if (position == 0) {
+            position = header_end;
+        }
+        if (size < position) {
+            throw runtime_error("log shrank below the replica's position");
+        }
+        in.clear();
+        return true;
+    }
+    // Returns false if the record's payload is not completely written yet
+    bool applyRecord(const string& line, ifstream& in){
+        istringstream ss(line);
+        long long seq = 0;
+        time_t timestamp = 0;
+        ss >> seq >> timestamp;
+        vector<string> tokens;
+        string token;
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+        if (seq != applied_seq + 1 || tokens.size() < 2) {
+            throw runtime_error("log does not continue at seq " + to_string(applied_seq + 1));
+        }
+        bool has_payload = (tokens[0] == "INSERT_DATA" || tokens[0] == "UPDATE_DATA");
+        if (has_payload) {
+            if (tokens.size() < 3) {
+                throw runtime_error("corrupt log record at seq " + to_string(seq));
+            }
+            streamoff payload_start = in.tellg();
+            in.seekg(0, ios::end);
+            streamoff size = in.tellg();
+            in.seekg(payload_start);
+            if (size < payload_start + stoll(tokens[2]) + 1) {
+                return false;
+            }
+        }
+
+        unique_lock<shared_mutex> guard(state_lock);
+        PinnedClock clock(timestamp);          // reproduce the primary's timestamps
+        apply(tokens, in);
+        if (has_payload && in.get() != '\n') {
+            throw runtime_error("corrupt log record at seq " + to_string(seq));
+        }
+        lock_guard<mutex> status_guard(status_lock);
+        applied_seq = seq;
+        applied_timestamp = timestamp;
+        offset = in.tellg();
+        return true;
+    }
+};
+
 // ==================== Command processor ================================
 class CommandProcessor {
 private:
     FileSystemManager fsManager;
+    bool is_replica;             // events are published by the tailer, so EVENTS may wait for them
     
 public:
+    CommandProcessor(){
+        this->is_replica = false;
+    }
 
+    void useChunkStore(const string& path, int chunk_size, int cache_chunks){
+        fsManager.useChunkStore(path, chunk_size, cache_chunks);
+    }
+    void useMutationLog(const string& path){
+        fsManager.useMutationLog(path);
+    }
     void processCommand(const string& command){
         vector<string> tokens = parseCommand(command);
         if (!tokens.empty()) {
-            executeCommand(tokens);
+            executeCommand(tokens, cout);
+        }
+    }
+    // Non-interactive mode: run all commands from stdin on num_threads worker threads
+    void runParallel(int num_threads){
+        CommandScheduler scheduler(num_threads, [this](const vector<string>& tokens, ostream& out){
+            executeCommand(tokens, out);
+        }, cout);
+
+        string line;
+        while (getline(cin, line)) {
+            if (line == "EXIT"||line=="exit"||line=="Exit") break;
+            vector<string> tokens = parseCommand(line);
+            if (!tokens.empty()) {
+                scheduler.submit(tokens);
+            }
+        }
+        scheduler.finish();
+    }
+    // Read-only replica: follow the primary's mutation log and serve read commands from stdin
+    void runReplica(const string& log_path, const string& checkpoint_path, long long max_staleness_ms){
+        is_replica = true;
+        string epoch;
+        long long seq = 0;
+        streamoff offset = 0;
+        if (!checkpoint_path.empty()) {
+            ifstream in(checkpoint_path, ios::binary);
+            string magic;
+            in >> magic >> epoch >> seq >> offset;
+            if (!in || magic != "TTFS-CHECKPOINT") {
+                throw runtime_error("Not a checkpoint: " + checkpoint_path);
+            }
+            if (epoch == "-") epoch = "";       // taken before the log header was read
+            fsManager.loadState(in);
+        }
+        LogReplica replica(log_path, [this](const vector<string>& tokens, istream& payload){
+            if (tokens[0] == "INSERT_DATA") {
+                fsManager.insertFileData(tokens[1], payload, stoll(tokens[2]));
+            } else if (tokens[0] == "UPDATE_DATA") {
+                fsManager.updateFileData(tokens[1], payload, stoll(tokens[2]));
+            } else {
+                ostream discard(nullptr);
+                executeCommand(tokens, discard);
+            }
+        }, epoch, seq, offset);
+
+        string line;
+        cout << "******Time-Travelling File System replica of " << log_path << "******\n";
+        cout << "Enter commands: " ;
+        cout<< "(Type EXIT to quit.)\n";
+
+        while (true) {
+            cout << "> ";
+            if (!getline(cin, line)) break;  // Exit on EOF or error
+            if (line == "EXIT"||line=="exit"||line=="Exit") break;
+            try {
+                vector<string> tokens = parseCommand(line);
+                if (!tokens.empty()) {
+                    executeReplicaCommand(tokens, cout, replica, max_staleness_ms);
+                }
+            } catch (const  exception& e) {
+                cout << "Error: " << e.what() << endl;
+            }
         }
     }
     void run(){
@@ -627,6 +2391,25 @@ public:
     
 private:
     
+    // "--from <id>" / "--depth <d>" pairs from tokens[first] on; --from only where from_id is given.
+    // Returns false for any other token or an option without a value
+    static bool parseTreeOptions(const vector<string>& tokens, size_t first, int* from_id, int& max_depth) {
+        for (size_t i = first; i < tokens.size(); i += 2) {
+            if (i + 1 >= tokens.size()) return false;
+            if (tokens[i] == "--from" && from_id != nullptr) *from_id = stoi(tokens[i + 1]);
+            else if (tokens[i] == "--depth") max_depth = stoi(tokens[i + 1]);
+            else return false;
+        }
+        return true;
+    }
+    static string joinIds(const vector<int>& ids) {
+        if (ids.empty()) return "(none)";
+        string joined = to_string(ids[0]);
+        for (size_t i = 1; i < ids.size(); i++) {
+            joined += " " + to_string(ids[i]);
+        }
+        return joined;
+    }
     vector<string> parseCommand(const string& command) {
         vector<string> tokens;
         stringstream ss(command);
@@ -637,7 +2420,64 @@ private:
         }
         return tokens;
     }
-    void executeCommand(const vector<string>& tokens){
+    void executeReplicaCommand(const vector<string>& tokens, ostream& out, LogReplica& replica, long long max_staleness_ms){
+        string cmd = tokens[0];
+        transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+
+        if (cmd == "STATUS") {
+            out << replica.status() << endl;
+        }
+        else if (cmd == "SYNC") {
+            int timeout_ms = 10000; // default
+            if (tokens.size() >= 2) {
+                timeout_ms = stoi(tokens[1]);
+            }
+            if (replica.sync(timeout_ms)) {
+                out << "Replica caught up." << endl;
+            } else {
+                out << "Replica did not catch up: " << replica.status() << endl;
+            }
+        }
+        else if (cmd == "CHECKPOINT") {
+            if (tokens.size() < 2) {
+                out << "Usage: CHECKPOINT <path>" << endl;
+                return;
+            }
+            ofstream file(tokens[1], ios::binary | ios::trunc);
+            if (!file) {
+                throw runtime_error("Cannot open checkpoint file: " + tokens[1]);
+            }
+            shared_lock<shared_mutex> guard = replica.lockForRead();
+            string epoch;
+            long long seq = 0;
+            streamoff offset = 0;
+            replica.position(epoch, seq, offset);
+            file << "TTFS-CHECKPOINT " << (epoch.empty() ? "-" : epoch) << ' ' << seq << ' ' << offset << '\n';
+            fsManager.saveState(file);
+            if (!file.flush()) {
+                throw runtime_error("Failed to write checkpoint: " + tokens[1]);
+            }
+            out << "Checkpoint at seq " << seq << " written to " << tokens[1] << "." << endl;
+        }
+        else if (cmd == "WATCH" || cmd == "UNWATCH" || cmd == "EVENTS") {
+            // The feed has its own locking; EVENTS may block, so it must not hold up the tailer
+            executeCommand(tokens, out);
+        }
+        else if (cmd == "CREATE" || cmd == "INSERT" || cmd == "UPDATE" || cmd == "INSERT_FILE" ||
+                 cmd == "UPDATE_FILE" || cmd == "SNAPSHOT" || cmd == "ROLLBACK") {
+            out << "Read-only replica: " << cmd << " must be sent to the primary." << endl;
+        }
+        else {
+            long long staleness = replica.stalenessMs();
+            if (max_staleness_ms >= 0 && staleness > max_staleness_ms) {
+                out << "Replica is stale: " << staleness << " ms behind (limit " << max_staleness_ms << " ms)." << endl;
+                return;
+            }
+            shared_lock<shared_mutex> guard = replica.lockForRead();
+            executeCommand(tokens, out);
+        }
+    }
+    void executeCommand(const vector<string>& tokens, ostream& out){
         if (tokens.empty()) return;
         
         string cmd = tokens[0];
@@ -645,31 +2485,30 @@ private:
         
         if (cmd == "CREATE") {
             if (tokens.size() < 2) {
-                cout << "Usage: CREATE <filename>" << endl;
+                out << "Usage: CREATE <filename>" << endl;
                 return;
             }
             if (fsManager.createFile(tokens[1])) {
-                cout << "File '" << tokens[1] << "' created successfully." << endl;
+                out << "File '" << tokens[1] << "' created successfully." << endl;
             } else {
-                cout << "Failed to create file '" << tokens[1] << "'." << endl;
+                out << "Failed to create file '" << tokens[1] << "'." << endl;
             }
         }
         else if (cmd == "READ") {
             if (tokens.size() < 2) {
-                cout << "Usage: READ <filename>" << endl;
+                out << "Usage: READ <filename>" << endl;
                 return;
             }
-            string content;
-            if (fsManager.readFile(tokens[1], content)) {
-                cout << content << endl;
+            if (fsManager.readFileTo(tokens[1], out)) {
+                out << endl;
             }
             else{
-                cout << "File not found: " << tokens[1] << endl;
+                out << "File not found: " << tokens[1] << endl;
             }
         }
         else if (cmd == "INSERT" ) {
             if (tokens.size() < 3) {
-                cout << "Usage: INSERT <filename> <content>" << endl;
+                out << "Usage: INSERT <filename> <content>" << endl;
                 return;
             }
             string content = tokens[2];
@@ -677,14 +2516,14 @@ private:
                 content += " " + tokens[i];
             }
             if (fsManager.insertFile(tokens[1], content)) {
-                cout << "Content inserted successfully." << endl;
+                out << "Content inserted successfully." << endl;
             } else {
-                cout << "Failed to insert content." << endl;
+                out << "Failed to insert content." << endl;
             }
         }
         else if (cmd == "UPDATE") {
             if (tokens.size() < 3) {
-                cout << "Usage: UPDATE <filename> <content>" << endl;
+                out << "Usage: UPDATE <filename> <content>" << endl;
                 return;
             }
             string content = tokens[2];
@@ -692,14 +2531,37 @@ private:
                 content += " " + tokens[i];
             }
             if (fsManager.updateFile(tokens[1], content)) {
-                cout << "Content updated successfully." << endl;
+                out << "Content updated successfully." << endl;
+            } else {
+                out << "Failed to update content." << endl;
+            }
+        }
+        else if (cmd == "INSERT_FILE" || cmd == "UPDATE_FILE") {
+            if (tokens.size() < 3) {
+                out << "Usage: " << cmd << " <filename> <path>" << endl;
+                return;
+            }
+            string path = tokens[2];
+            for(size_t i = 3;i<tokens.size();i++){
+                path += " " + tokens[i];
+            }
+            if (cmd == "INSERT_FILE") {
+                if (fsManager.insertFileFrom(tokens[1], path)) {
+                    out << "Content inserted successfully." << endl;
+                } else {
+                    out << "Failed to insert content." << endl;
+                }
             } else {
-                cout << "Failed to update content." << endl;
+                if (fsManager.updateFileFrom(tokens[1], path)) {
+                    out << "Content updated successfully." << endl;
+                } else {
+                    out << "Failed to update content." << endl;
+                }
             }
         }
         else if (cmd == "SNAPSHOT") {
             if (tokens.size() < 3) {
-                cout << "Usage: SNAPSHOT <filename> <message>" << endl;
+                out << "Usage: SNAPSHOT <filename> <message>" << endl;
                 return;
             }
             string message = tokens[2];
@@ -707,14 +2569,14 @@ private:
                 message += " " + tokens[i];
             }
             if (fsManager.snapshotFile(tokens[1], message)) {
-                cout << "Snapshot created successfully." << endl;
+                out << "Snapshot created successfully." << endl;
             } else {
-                cout << "Failed to create snapshot." << endl;
+                out << "Failed to create snapshot." << endl;
             }
         }
         else if (cmd == "ROLLBACK") {
             if (tokens.size() < 2) {
-                cout << "Usage: ROLLBACK <filename> [version_id]" << endl;
+                out << "Usage: ROLLBACK <filename> [version_id]" << endl;
                 return;
             }
             int version_id = -1;
@@ -722,29 +2584,150 @@ private:
                 version_id = stoi(tokens[2]);
             }
             if (fsManager.rollbackFile(tokens[1], version_id)) {
-                cout << "Rollback successful." << endl;
+                out << "Rollback successful." << endl;
             } else {
-                cout << "Rollback failed." << endl;
+                out << "Rollback failed." << endl;
             }
             
         }
         else if (cmd == "HISTORY") {
             if (tokens.size() < 2) {
-                cout << "Usage: HISTORY <filename>" << endl;
+                out << "Usage: HISTORY <filename>" << endl;
                 return;
             }
             vector<string> history;
             if (fsManager.getHistory(tokens[1], history)) {
                 for(string& str : history){
-                    cout << str << endl;
+                    out << str << endl;
                 }
             }else {
-                cout << "Failed to get history for " << tokens[1] << endl;
+                out << "Failed to get history for " << tokens[1] << endl;
+            }
+        }
+        else if (cmd == "TREE") {
+            if (tokens.size() < 2) {
+                out << "Usage: TREE <filename> [--from version_id] [--depth d]" << endl;
+                return;
+            }
+            int from_id = 0, max_depth = -1;
+            if (!parseTreeOptions(tokens, 2, &from_id, max_depth)) {
+                out << "Usage: TREE <filename> [--from version_id] [--depth d]" << endl;
+                return;
+            }
+            if (!fsManager.exportTree(tokens[1], out, from_id, max_depth)) {
+                out << "File not found: " << tokens[1] << endl;
+            }
+        }
+        else if (cmd == "DESCENDANTS") {
+            if (tokens.size() < 3) {
+                out << "Usage: DESCENDANTS <filename> <version_id> [--depth d]" << endl;
+                return;
+            }
+            int max_depth = -1;
+            if (!parseTreeOptions(tokens, 3, nullptr, max_depth)) {
+                out << "Usage: DESCENDANTS <filename> <version_id> [--depth d]" << endl;
+                return;
+            }
+            vector<int> descendants;
+            if (fsManager.getDescendants(tokens[1], stoi(tokens[2]), max_depth, descendants)) {
+                out << joinIds(descendants) << endl;
+            } else {
+                out << "File not found: " << tokens[1] << endl;
+            }
+        }
+        else if (cmd == "ANCESTORS") {
+            if (tokens.size() < 3) {
+                out << "Usage: ANCESTORS <filename> <version_id> [ancestor_id]" << endl;
+                return;
+            }
+            int version_id = stoi(tokens[2]);
+            if (tokens.size() >= 4) {
+                // Membership check only
+                int ancestor_id = stoi(tokens[3]);
+                bool result = false;
+                if (fsManager.isAncestor(tokens[1], ancestor_id, version_id, result)) {
+                    out << "Version " << ancestor_id << (result ? " is" : " is not") << " an ancestor of version " << version_id << "." << endl;
+                } else {
+                    out << "File not found: " << tokens[1] << endl;
+                }
+                return;
+            }
+            vector<int> ancestors;
+            if (fsManager.getAncestors(tokens[1], version_id, ancestors)) {
+                out << joinIds(ancestors) << endl;
+            } else {
+                out << "File not found: " << tokens[1] << endl;
+            }
+        }
+        else if (cmd == "WATCH") {
+            if (tokens.size() < 2) {
+                out << "Usage: WATCH <filename|prefix*> [capacity]" << endl;
+                return;
+            }
+            int capacity = 1024; // default
+            if (tokens.size() >= 3) {
+                capacity = stoi(tokens[2]);
+            }
+            if (capacity <= 0 || (size_t)capacity > EventRing::MAX_CAPACITY) {
+                out << "Capacity must be between 1 and " << EventRing::MAX_CAPACITY << "." << endl;
+                return;
+            }
+            int id = fsManager.watch(tokens[1], capacity);
+            out << "Watching '" << tokens[1] << "' (subscription " << id << ")." << endl;
+        }
+        else if (cmd == "UNWATCH") {
+            if (tokens.size() < 2) {
+                out << "Usage: UNWATCH <subscription_id>" << endl;
+                return;
+            }
+            if (fsManager.unwatch(stoi(tokens[1]))) {
+                out << "Subscription " << tokens[1] << " removed." << endl;
+            } else {
+                out << "No subscription " << tokens[1] << "." << endl;
+            }
+        }
+        else if (cmd == "EVENTS") {
+            if (tokens.size() < 2) {
+                out << "Usage: EVENTS <subscription_id> [timeout_ms] [max]" << endl;
+                return;
+            }
+            int timeout_ms = 0, max_events = 100; // default: don't wait
+            if (tokens.size() >= 3) {
+                timeout_ms = stoi(tokens[2]);
+            }
+            if (tokens.size() >= 4) {
+                max_events = stoi(tokens[3]);
+            }
+            if (max_events <= 0) {
+                out << "Max events must be positive." << endl;
+                return;
+            }
+            if (timeout_ms > 0 && !is_replica) {
+                // On a primary, commands run one at a time (EVENTS is a barrier with --jobs), so
+                // nothing could publish while EVENTS waits
+                out << "EVENTS can only wait on a replica; use a timeout of 0 on the primary." << endl;
+                return;
+            }
+            vector<ChangeEvent> events;
+            if (!fsManager.getEvents(stoi(tokens[1]), max_events, timeout_ms, events)) {
+                out << "No subscription " << tokens[1] << "." << endl;
+                return;
+            }
+            if (events.empty()) {
+                out << "No events." << endl;
+            }
+            for (const ChangeEvent& event : events) {
+                // Format output string (e.g., "2025-09-10 15:21:10 NEW_VERSION notes 3")
+                out << formatTimestamp(event.timestamp) << " " << event.kind << " " << event.filename << " " << event.version_id;
+                if (event.coalesced > 0) {
+                    out << " (+" << event.coalesced << " coalesced)";
+                }
+                out << endl;
             }
         }
         else if (cmd == "RECENT_FILES") {
             if (tokens.size() < 2 ) {
-                cout << "Usage: RECENT_FILES [num]" << endl;
+                out << "Usage: RECENT_FILES [num]" << endl;
                 return;
             }
             int num = 10; // default
@@ -753,12 +2736,12 @@ private:
             }
             vector<string> recent = fsManager.getRecentFiles(num);
             for (const string& filename : recent) {
-                cout << filename << endl;
+                out << filename << endl;
             }
         }
         else if (cmd == "BIGGEST_TREES") {
             if (tokens.size() < 2) {
-                cout << "Usage: BIGGEST TREES [num]" << endl;
+                out << "Usage: BIGGEST TREES [num]" << endl;
                 return;
             }
             int num = 10; // default
@@ -767,12 +2750,12 @@ private:
             }
             vector<string> biggest = fsManager.getBiggestTrees(num);
             for (const string& filename : biggest) {
-                cout << filename << endl;
+                out << filename << endl;
             }
         }
         else {
-            cout << "Unknown command: " << cmd << endl;
-            cout << "Available commands: CREATE, READ, INSERT, UPDATE, SNAPSHOT, ROLLBACK, HISTORY, RECENT_FILES, BIGGEST_TREES, EXIT" << endl;
+            out << "Unknown command: " << cmd << endl;
+            out << "Available commands: CREATE, READ, INSERT, UPDATE, INSERT_FILE, UPDATE_FILE, SNAPSHOT, ROLLBACK, HISTORY, TREE, DESCENDANTS, ANCESTORS, WATCH, UNWATCH, EVENTS, RECENT_FILES, BIGGEST_TREES, EXIT" << endl;
         }
     }
 };
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# === Differential fuzzing of FileSystemManager against an STL reference model ===
+# Usage: ./fuzz.sh [seeds] [operations_per_seed]
+SEEDS=${1:-10}
+OPERATIONS=${2:-20000}
+
+# === Compile the fuzz driver with AddressSanitizer and UBSan ===
+g++ -std=c++17 -O1 -g -fno-omit-frame-pointer -fsanitize=address,undefined -Wall -pthread fuzz_file_system.cpp -o fuzz_file_system
+if [ $? -ne 0 ]; then
+    echo "Compilation failed!"
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# === Every seed runs in memory and with the chunk store; stop at the first mismatch or sanitizer report ===
+export UBSAN_OPTIONS=halt_on_error=1:print_stacktrace=1
+for ((seed = 1; seed <= SEEDS; seed++)); do
+    ./fuzz_file_system $seed $OPERATIONS || exit 1
+    ./fuzz_file_system $seed $OPERATIONS --store "$WORK/store.bin" || exit 1
+done
@@ -0,0 +1,600 @@
+#include "file_system.hpp"
+#include <map>
+#include <set>
+#include <cstdlib>
+
+// Differential fuzz driver: runs random command sequences against FileSystemManager and
+// against a small reference model built on std::map/std::vector, and stops at the first
+// difference in READ, HISTORY, the version tree (IDs, parents, snapshots, active version),
+// the tree queries, RECENT_FILES/BIGGEST_TREES or the events of a WATCH on every file.
+// Usage: fuzz_file_system [seed] [operations] [--store <data_file>]
+
+// ===== Reference model =====
+struct RefVersion {
+    int parent;
+    string content;
+    bool is_snapshot;
+    string message;
+    time_t snapshot_timestamp;
+    vector<int> children;
+};
+
+struct RefFile {
+    vector<RefVersion> versions;         // index == version_id
+    int active;
+    time_t last_modified;
+
+    RefVersion& current(){
+        return versions[active];
+    }
+    // Same rule as File::insert/update: editing a snapshot first branches a new version.
+    // Returns true if it did
+    bool prepareEdit(bool keep_content){
+        if (!current().is_snapshot) return false;
+        RefVersion child;
+        child.parent = active;
+        child.content = keep_content ? current().content : "";
+        child.is_snapshot = false;
+        child.snapshot_timestamp = 0;
+        versions.push_back(child);
+        versions[active].children.push_back(versions.size() - 1);
+        active = versions.size() - 1;
+        return true;
+    }
+    int depth(int id){
+        int d = 0;
+        for (int v = versions[id].parent; v != -1; v = versions[v].parent) d++;
+        return d;
+    }
+    // Pre-order with children in creation order, as File::exportTree
+    vector<int> preorder(int from){
+        vector<int> order, pending(1, from);
+        while (!pending.empty()) {
+            int id = pending.back();
+            pending.pop_back();
+            order.push_back(id);
+            const vector<int>& children = versions[id].children;
+            for (auto it = children.rbegin(); it != children.rend(); ++it) pending.push_back(*it);
+        }
+        return order;
+    }
+};
+
+// One WATCH subscription (see Subscription): events queue in a ring of <capacity> slots; once
+// it is full they are coalesced per file behind it, the newest event of a file moving to the end
+struct RefFeed {
+    size_t capacity;
+    deque<ChangeEvent> ring;
+    vector<ChangeEvent> overflow;
+
+    RefFeed(int watch_capacity = 1){
+        capacity = 2;                        //EventRing rounds up to a power of two, at least 2
+        while (capacity < (size_t)watch_capacity) capacity *= 2;
+    }
+    void publish(const ChangeEvent& event){
+        if (overflow.empty() && ring.size() < capacity) {
+            ring.push_back(event);
+            return;
+        }
+        ChangeEvent merged = event;
+        for (size_t i = 0; i < overflow.size(); i++) {
+            if (overflow[i].filename == event.filename) {
+                merged.coalesced = overflow[i].coalesced + 1;
+                overflow.erase(overflow.begin() + i);
+                break;
+            }
+        }
+        overflow.push_back(merged);
+    }
+    vector<ChangeEvent> drain(int max_events){
+        vector<ChangeEvent> events;
+        while ((int)events.size() < max_events && !ring.empty()) {
+            events.push_back(ring.front());
+            ring.pop_front();
+        }
+        size_t taken = 0;
+        while (taken < overflow.size() && (int)events.size() < max_events) {
+            events.push_back(overflow[taken++]);
+        }
+        overflow.erase(overflow.begin(), overflow.begin() + taken);
+        return events;
+    }
+};
+
+static string formatEvents(const vector<ChangeEvent>& events){
+    string formatted;
+    for (const ChangeEvent& event : events) {
+        formatted += string(event.kind) + " " + event.filename + " " + to_string(event.version_id) + " @" + to_string(event.timestamp);
+        if (event.coalesced > 0) formatted += " (+" + to_string(event.coalesced) + ")";
+        formatted += " | ";
+    }
+    return formatted;
+}
+
+class Fuzzer {
+private:
+    mt19937 rng;
+    unsigned seed;
+    FileSystemManager* fs;
+    string store_path;
+    map<string, RefFile> model;
+    RefFeed feed;
+    int subscription;
+    time_t now;
+    long long step;
+    deque<string> trace;                 // last operations, printed on failure
+
+    static const int TRACE_LENGTH = 25;
+
+public:
+    Fuzzer(unsigned seed, const string& store_path) : rng(seed){
+        this->seed = seed;
+        this->store_path = store_path;
+        this->fs = newManager();
+        this->now = 1700000000;
+        this->step = 0;
+        subscribe();
+    }
+    ~Fuzzer(){
+        delete fs;
+    }
+
+    void run(long long operations){
+        for (step = 0; step < operations; step++) {
+            //Several operations per second, so timestamps tie and the heaps must break ties the same way
+            if (pick(3) == 0) now++;
+            PinnedClock clock(now);
+            int op = pick(100);
+            if (op < 8) doCreate();
+            else if (op < 30) doInsert();
+            else if (op < 40) doUpdate();
+            else if (op < 48) doStream();
+            else if (op < 60) doSnapshot();
+            else if (op < 72) doRollback();
+            else if (op < 80) checkRead();
+            else if (op < 86) checkHistory();
+            else if (op < 92) checkTreeQueries();
+            else if (op < 96) checkAnalytics();
+            else if (op < 99) checkEvents();
+            else checkCheckpoint();
+            if (step % 64 == 0) checkAll();
+        }
+        checkAll();
+    }
+
+private:
+    FileSystemManager* newManager(){
+        FileSystemManager* manager = new FileSystemManager();
+        if (!store_path.empty()) {
+            //Tiny chunks and cache, so most contents span chunks and most reads miss the cache
+            manager->useChunkStore(store_path, 7, 4);
+        }
+        return manager;
+    }
+    // WATCH every file with a tiny capacity, so the overflow path is taken all the time
+    void subscribe(){
+        int capacity = 1 + pick(5);
+        subscription = fs->watch("*", capacity);
+        feed = RefFeed(capacity);
+    }
+    void expectEvent(const char* kind, const string& name, int version_id){
+        ChangeEvent event;
+        event.kind = kind;
+        event.filename = name;
+        event.version_id = version_id;
+        event.timestamp = now;
+        feed.publish(event);
+    }
+    int pick(int n){
+        return uniform_int_distribution<int>(0, n - 1)(rng);
+    }
+    // A few names, so most commands hit an existing file and some hit a missing one
+    string pickName(){
+        static const char* names[] = {"a", "b", "notes", "notes2", "x", "y_1", "zz", "missing"};
+        return names[pick(8)];
+    }
+    string randomText(){
+        static const string alphabet = "abcdefghijklmnopqrstuvwxyz0123456789 _-";
+        int length = (pick(10) == 0) ? pick(40) : pick(8);      //sometimes longer than a chunk
+        string text;
+        for (int i = 0; i < length; i++) text += alphabet[pick(alphabet.size())];
+        return text;
+    }
+    RefFile* findRef(const string& name){
+        auto it = model.find(name);
+        return (it != model.end()) ? &it->second : nullptr;
+    }
+    void record(const string& operation){
+        trace.push_back(operation);
+        if (trace.size() > TRACE_LENGTH) trace.pop_front();
+    }
+    void fail(const string& what, const string& expected, const string& actual){
+        cout << "MISMATCH (seed " << seed << ", step " << step << "): " << what << endl;
+        cout << "  expected: " << expected << endl;
+        cout << "  actual:   " << actual << endl;
+        cout << "Last operations:" << endl;
+        for (const string& operation : trace) cout << "  " << operation << endl;
+        exit(1);
+    }
+    void expectEqual(const string& what, const string& expected, const string& actual){
+        if (expected != actual) fail(what, expected, actual);
+    }
+    void expectResult(const string& what, bool expected, bool actual){
+        if (expected != actual) fail(what, expected ? "true" : "false", actual ? "true" : "false");
+    }
+    static string join(const vector<string>& lines){
+        string joined;
+        for (const string& line : lines) joined += line + " | ";
+        return joined;
+    }
+    static string joinIds(const vector<int>& ids){
+        string joined;
+        for (int id : ids) joined += to_string(id) + " ";
+        return joined;
+    }
+
+    // ===== Mutations =====
+    void doCreate(){
+        string name = pickName();
+        record("CREATE " + name);
+        bool expected = (findRef(name) == nullptr);
+        if (expected) {
+            RefFile file;
+            RefVersion root;
+            root.parent = -1;
+            root.is_snapshot = true;
+            root.message = "Initial Snapshot";
+            root.snapshot_timestamp = now;
+            file.versions.push_back(root);
+            file.active = 0;
+            file.last_modified = now;
+            model[name] = file;
+            expectEvent("CREATED", name, 0);
+        }
+        expectResult("CREATE " + name, expected, fs->createFile(name));
+    }
+    void doInsert(){
+        string name = pickName(), text = randomText();
+        record("INSERT " + name + " '" + text + "'");
+        RefFile* file = findRef(name);
+        if (file != nullptr) {
+            bool branched = file->prepareEdit(true);
+            file->current().content += " " + text;
+            file->last_modified = now;
+            expectEvent(branched ? "NEW_VERSION" : "MODIFIED", name, file->active);
+        }
+        expectResult("INSERT " + name, file != nullptr, fs->insertFile(name, text));
+    }
+    void doUpdate(){
+        string name = pickName(), text = randomText();
+        record("UPDATE " + name + " '" + text + "'");
+        RefFile* file = findRef(name);
+        if (file != nullptr) {
+            bool branched = file->prepareEdit(false);
+            file->current().content = text;
+            file->last_modified = now;
+            expectEvent(branched ? "NEW_VERSION" : "MODIFIED", name, file->active);
+        }
+        expectResult("UPDATE " + name, file != nullptr, fs->updateFile(name, text));
+    }
+    // INSERT_FILE/UPDATE_FILE and replica payloads: content streamed with an optional length limit
+    void doStream(){
+        string name = pickName(), text = randomText() + randomText();
+        bool insert = pick(2) == 0;
+        long long limit = (pick(3) == 0) ? -1 : pick(text.size() + 1);
+        string taken = (limit < 0) ? text : text.substr(0, limit);
+        record(string(insert ? "INSERT_DATA " : "UPDATE_DATA ") + name + " '" + text + "' limit " + to_string(limit));
+        RefFile* file = findRef(name);
+        if (file != nullptr) {
+            bool branched = file->prepareEdit(insert);
+            if (insert) file->current().content += " " + taken;
+            else file->current().content = taken;
+            file->last_modified = now;
+            expectEvent(branched ? "NEW_VERSION" : "MODIFIED", name, file->active);
+        }
+        istringstream in(text);
+        bool result = insert ? fs->insertFileData(name, in, limit) : fs->updateFileData(name, in, limit);
+        expectResult("stream into " + name, file != nullptr, result);
+    }
+    void doSnapshot(){
+        string name = pickName(), message = randomText();
+        record("SNAPSHOT " + name + " '" + message + "'");
+        RefFile* file = findRef(name);
+        bool expect_error = (file != nullptr && file->current().is_snapshot);
+        if (file != nullptr && !expect_error) {
+            file->current().is_snapshot = true;
+            file->current().message = message;
+            file->current().snapshot_timestamp = now;
+            expectEvent("SNAPSHOT", name, file->active);
+        }
+        bool threw = false, result = false;
+        try {
+            result = fs->snapshotFile(name, message);
+        } catch (const logic_error&) {
+            threw = true;
+        }
+        expectResult("SNAPSHOT " + name + " throws", expect_error, threw);
+        if (!threw) expectResult("SNAPSHOT " + name, file != nullptr, result);
+    }
+    void doRollback(){
+        string name = pickName();
+        RefFile* file = findRef(name);
+        //Mostly existing versions, sometimes the parent (-1) or an ID past the end
+        int version_id = -1;
+        if (pick(3) != 0) {
+            int versions = (file != nullptr) ? file->versions.size() : 3;
+            version_id = pick(versions + 2);
+        }
+        record("ROLLBACK " + name + " " + to_string(version_id));
+        bool expect_error = (file != nullptr && version_id == -1 && file->current().parent == -1);
+        bool expected = false;
+        if (file != nullptr && !expect_error) {
+            if (version_id == -1) {
+                file->active = file->current().parent;
+                expected = true;
+            } else if (version_id < (int)file->versions.size()) {
+                file->active = version_id;
+                expected = true;
+            }
+            if (expected) expectEvent("ROLLBACK", name, file->active);
+        }
+        bool threw = false, result = false;
+        try {
+            result = fs->rollbackFile(name, version_id);
+        } catch (const logic_error&) {
+            threw = true;
+        }
+        expectResult("ROLLBACK " + name + " throws", expect_error, threw);
+        if (!threw) expectResult("ROLLBACK " + name + " " + to_string(version_id), expected, result);
+    }
+
+    // ===== Checks =====
+    void checkRead(){
+        string name = pickName();
+        record("READ " + name);
+        compareRead(*fs, name);
+    }
+    void compareRead(FileSystemManager& manager, const string& name){
+        RefFile* file = findRef(name);
+        string content;
+        bool found = manager.readFile(name, content);
+        expectResult("READ " + name, file != nullptr, found);
+        if (file == nullptr) return;
+        expectEqual("READ " + name, file->current().content, content);
+        ostringstream streamed;
+        manager.readFileTo(name, streamed);
+        expectEqual("streamed READ " + name, file->current().content, streamed.str());
+    }
+    void checkHistory(){
+        string name = pickName();
+        record("HISTORY " + name);
+        compareHistory(*fs, name);
+    }
+    void compareHistory(FileSystemManager& manager, const string& name){
+        RefFile* file = findRef(name);
+        vector<string> history;
+        expectResult("HISTORY " + name, file != nullptr, manager.getHistory(name, history));
+        if (file == nullptr) return;
+        vector<string> expected;
+        for (int id = file->active; id != -1; id = file->versions[id].parent) {
+            const RefVersion& version = file->versions[id];
+            if (version.is_snapshot) {
+                expected.push_back("ID: " + to_string(id) + ", Timestamp: " + formatTimestamp(version.snapshot_timestamp) + ", Message: " + version.message);
+            }
+        }
+        reverse(expected.begin(), expected.end());
+        expectEqual("HISTORY " + name, join(expected), join(history));
+    }
+    // The whole version tree: IDs, parents, depths, snapshot flags and the active version
+    void compareTree(FileSystemManager& manager, const string& name){
+        RefFile& file = model[name];
+        ostringstream expected, actual;
+        for (int id : file.preorder(0)) {
+            string flags;
+            if (file.versions[id].is_snapshot) flags += "S";
+            if (id == file.active) flags += "A";
+            if (flags.empty()) flags = "-";
+            expected << id << ' ' << file.versions[id].parent << ' ' << file.depth(id) << ' ' << flags << '\n';
+        }
+        manager.exportTree(name, actual);
+        expectEqual("TREE " + name, expected.str(), actual.str());
+    }
+    void checkTreeQueries(){
+        string name = pickName();
+        RefFile* file = findRef(name);
+        if (file == nullptr) return;
+        int versions = file->versions.size();
+        int id = pick(versions), other = pick(versions), max_depth = pick(4) - 1;
+        record("TREE QUERIES " + name + " " + to_string(id) + " " + to_string(other) + " depth " + to_string(max_depth));
+
+        vector<int> expected, actual;
+        int base = file->depth(id);
+        for (int v : file->preorder(id)) {
+            if (v != id && (max_depth < 0 || file->depth(v) - base <= max_depth)) expected.push_back(v);
+        }
+        fs->getDescendants(name, id, max_depth, actual);
+        expectEqual("DESCENDANTS " + name + " " + to_string(id), joinIds(expected), joinIds(actual));
+
+        expected.clear();
+        for (int v = file->versions[id].parent; v != -1; v = file->versions[v].parent) expected.push_back(v);
+        fs->getAncestors(name, id, actual);
+        expectEqual("ANCESTORS " + name + " " + to_string(id), joinIds(expected), joinIds(actual));
+
+        bool is_ancestor = false;
+        for (int v = file->versions[other].parent; v != -1; v = file->versions[v].parent) {
+            if (v == id) is_ancestor = true;
+        }
+        bool result = false;
+        fs->isAncestor(name, id, other, result);
+        expectResult("IS_ANCESTOR " + name + " " + to_string(id) + " " + to_string(other), is_ancestor, result);
+
+        bool threw = false;
+        try {
+            fs->getDescendants(name, versions, -1, actual);
+        } catch (const invalid_argument&) {
+            threw = true;
+        }
+        expectResult("DESCENDANTS of a missing version throws", true, threw);
+    }
+    // RECENT_FILES/BIGGEST_TREES order: newest/biggest first, ties broken by the larger filename
+    void checkAnalytics(){
+        int num = pick(model.size() + 2);
+        record("RECENT_FILES/BIGGEST_TREES " + to_string(num));
+        vector<pair<time_t, string>> recent;
+        vector<pair<int, string>> biggest;
+        for (auto& entry : model) {
+            recent.push_back({entry.second.last_modified, entry.first});
+            biggest.push_back({(int)entry.second.versions.size(), entry.first});
+        }
+        sort(recent.rbegin(), recent.rend());
+        sort(biggest.rbegin(), biggest.rend());
+        vector<string> expected;
+        for (int i = 0; i < num && i < (int)recent.size(); i++) {
+            expected.push_back(recent[i].second + " (Last Modified: " + formatTimestamp(recent[i].first) + ")");
+        }
+        expectEqual("RECENT_FILES " + to_string(num), join(expected), join(fs->getRecentFiles(num)));
+        expected.clear();
+        for (int i = 0; i < num && i < (int)biggest.size(); i++) {
+            expected.push_back(biggest[i].second + " (Versions: " + to_string(biggest[i].first) + ")");
+        }
+        expectEqual("BIGGEST_TREES " + to_string(num), join(expected), join(fs->getBiggestTrees(num)));
+    }
+    // saveState/loadState round trip; the restored file system replaces the current one
+    void checkCheckpoint(){
+        record("CHECKPOINT");
+        stringstream state;
+        fs->saveState(state);
+        FileSystemManager* restored = newManager();
+        delete fs;                   //The store file is recreated by newManager, so release the old one first
+        fs = nullptr;
+        restored->loadState(state);
+        fs = restored;
+        subscribe();                 //Subscriptions are not part of a checkpoint
+        checkAll();
+    }
+    void checkEvents(){
+        int max_events = 1 + pick(4);
+        record("EVENTS " + to_string(subscription) + " 0 " + to_string(max_events));
+        vector<ChangeEvent> events;
+        expectResult("EVENTS " + to_string(subscription), true, fs->getEvents(subscription, max_events, 0, events));
+        expectEqual("EVENTS", formatEvents(feed.drain(max_events)), formatEvents(events));
+    }
+    void checkAll(){
+        for (auto& entry : model) {
+            compareRead(*fs, entry.first);
+            compareHistory(*fs, entry.first);
+            compareTree(*fs, entry.first);
+        }
+        string content;
+        if (findRef("missing") == nullptr) expectResult("READ missing", false, fs->readFile("missing", content));
+    }
+};
+
+// ===== HashMap and Heap against std::map and std::multiset =====
+static void fuzzStructures(unsigned seed, int operations){
+    mt19937 rng(seed);
+    auto pick = [&rng](int n){ return uniform_int_distribution<int>(0, n - 1)(rng); };
+    auto check = [seed](bool ok, const string& what){
+        if (!ok) {
+            cout << "MISMATCH (seed " << seed << "): " << what << endl;
+            exit(1);
+        }
+    };
+
+    HashMap<int, int> hash_map(17);
+    map<int, int> reference_map;
+    for (int i = 0; i < operations; i++) {
+        int key = pick(200) - 100;          //negative keys too
+        int op = pick(3);
+        if (op == 0) {
+            hash_map.insert(key, i);
+            reference_map[key] = i;
+        } else if (op == 1) {
+            check(hash_map.remove(key) == (reference_map.erase(key) == 1), "HashMap::remove " + to_string(key));
+        } else {
+            int* value = hash_map.find(key);
+            auto it = reference_map.find(key);
+            check((value != nullptr) == (it != reference_map.end()), "HashMap::find " + to_string(key));
+            if (value != nullptr) check(*value == it->second, "HashMap value of " + to_string(key));
+        }
+        check(hash_map.getSize() == (int)reference_map.size(), "HashMap::getSize");
+    }
+    int visited = 0;
+    hash_map.forEach([&](int key, int value){
+        visited++;
+        check(reference_map.count(key) && reference_map[key] == value, "HashMap::forEach " + to_string(key));
+    });
+    check(visited == (int)reference_map.size(), "HashMap::forEach count");
+
+    for (int max_heap = 0; max_heap < 2; max_heap++) {
+        Heap<pair<int, string>> heap(max_heap == 1);
+        multiset<pair<int, string>> reference_heap;
+        for (int i = 0; i < operations; i++) {
+            if (pick(3) != 0 || reference_heap.empty()) {
+                pair<int, string> item(pick(50), string(1, 'a' + pick(3)));
+                heap.insert(item);
+                reference_heap.insert(item);
+            } else {
+                auto top = max_heap ? prev(reference_heap.end()) : reference_heap.begin();
+                check(heap.peek() == *top, "Heap::peek");
+                check(heap.extractTop() == *top, "Heap::extractTop");
+                reference_heap.erase(top);
+            }
+            check(heap.size() == (int)reference_heap.size(), "Heap::size");
+        }
+        bool threw = false;
+        while (!heap.isEmpty()) heap.extractTop();
+        try {
+            heap.extractTop();
+        } catch (const out_of_range&) {
+            threw = true;
+        }
+        check(threw, "Heap::extractTop on an empty heap throws");
+    }
+}
+
+// Coalescing must not let a newer event overtake older events of other files
+static void checkOverflowOrder(){
+    FileSystemManager manager;
+    PinnedClock clock(1700000000);
+    manager.createFile("a");
+    manager.createFile("b");
+    int id = manager.watch("*", 2);
+    manager.insertFile("a", "1");
+    manager.insertFile("a", "2");
+    manager.insertFile("b", "1");
+    manager.insertFile("a", "3");
+    manager.snapshotFile("b", "sb");
+    vector<ChangeEvent> events;
+    manager.getEvents(id, 100, 0, events);
+    string order;
+    for (const ChangeEvent& event : events) order += string(event.kind) + " " + event.filename + " +" + to_string(event.coalesced) + "; ";
+    string expected = "NEW_VERSION a +0; MODIFIED a +0; MODIFIED a +0; SNAPSHOT b +1; ";
+    if (order != expected) {
+        cout << "MISMATCH: events after overflow" << endl;
+        cout << "  expected: " << expected << endl;
+        cout << "  actual:   " << order << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = 1;
+    long long operations = 20000;
+    string store_path;
+    vector<string> positional;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--store" && i + 1 < argc) store_path = argv[++i];
+        else positional.push_back(arg);
+    }
+    if (positional.size() >= 1) seed = stoul(positional[0]);
+    if (positional.size() >= 2) operations = stoll(positional[1]);
+
+    checkOverflowOrder();
+    fuzzStructures(seed, operations);
+    Fuzzer fuzzer(seed, store_path);
+    fuzzer.run(operations);
+    cout << "Seed " << seed << ": " << operations << " operations" << (store_path.empty() ? "" : " (chunk store)") << ", no mismatch." << endl;
+    return 0;
+}
@@ -1,9 +1,52 @@
-#include "file_system.hpp"     
+#include "file_system.hpp"
 #include <sstream>
 #include <algorithm>
 
-int main() {
+int main(int argc, char* argv[]) {
     CommandProcessor processor; //Create a CommandProcesor
-    processor.run();            // call run() functn to start the program
+
+    // Optional: --store <data_file> [--chunk-size <bytes>] [--cache-chunks <n>] [--jobs <n>]
+    //           --log <log_file>   (primary)  or  --replica <log_file> [--checkpoint <file>] [--max-staleness <ms>]
+    string store_path, log_path, replica_of, checkpoint_path;
+    int jobs = 0;
+    int chunk_size = 64 * 1024;
+    int cache_chunks = 256;
+    long long max_staleness_ms = -1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string opt = argv[i];
+        if (opt == "--store") store_path = argv[i + 1];
+        else if (opt == "--chunk-size") chunk_size = stoi(argv[i + 1]);
+        else if (opt == "--cache-chunks") cache_chunks = stoi(argv[i + 1]);
+        else if (opt == "--jobs") jobs = stoi(argv[i + 1]);
+        else if (opt == "--log") log_path = argv[i + 1];
+        else if (opt == "--replica") replica_of = argv[i + 1];
+        else if (opt == "--checkpoint") checkpoint_path = argv[i + 1];
+        else if (opt == "--max-staleness") max_staleness_ms = stoll(argv[i + 1]);
+        else {
+            cout << "Unknown option: " << opt << endl;
+            return 1;
+        }
+    }
+    try {
+        if (!store_path.empty()) {
+            processor.useChunkStore(store_path, chunk_size, cache_chunks);
+        }
+        if (!replica_of.empty()) {
+            processor.runReplica(replica_of, checkpoint_path, max_staleness_ms);
+            return 0;
+        }
+        if (!log_path.empty()) {
+            processor.useMutationLog(log_path);
+        }
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    if (jobs > 0) {
+        processor.runParallel(jobs);    // batch mode: commands from stdin run on <jobs> threads
+    } else {
+        processor.run();            // call run() functn to start the program
+    }
     return 0;
 }
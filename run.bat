@@ -1,7 +1,7 @@
 @echo off
 
 REM === Step 1: Compile main.cpp into file_system.exe ===
-g++ -std=c++17 -O2 -Wall main.cpp -o file_system.exe
+g++ -std=c++17 -O2 -Wall -pthread main.cpp -o file_system.exe
 
 REM === Step 2: Check if compilation failed ===
 IF ERRORLEVEL 1 (
@@ -11,4 +11,4 @@ IF ERRORLEVEL 1 (
 )
 
 REM === Step 3:  Run the program ===
-file_system.exe
+file_system.exe %*